@@ -12,6 +12,19 @@
 // Address to store the Password
 #define FLASH_PASSWORD_ADDR 0x00020000
 
+// Calculation history log (4 pages)
+#define FLASH_HISTORY_ADDR 0x00020400
+#define FLASH_HISTORY_SIZE 4096
+
+// Memory registers M1-M8 log (one page)
+#define FLASH_MEMORY_ADDR 0x00021400
+
+// Recorded key trace and its baseline (one page)
+#define FLASH_TRACE_ADDR 0x00021800
+
+// Erase granularity
+#define FLASH_PAGE_SIZE 1024
+
 // Initialize Flash 
 void Flash_Init(void);
 
@@ -5,6 +5,8 @@
 
 #include "SysTick.h"
 
+#include "power.h"
+
 #define NVIC_ST_CTRL_R (*((volatile unsigned long *)0xE000E010))
 #define NVIC_ST_RELOAD_R (*((volatile unsigned long *)0xE000E014))
 #define NVIC_ST_CURRENT_R (*((volatile unsigned long *)0xE000E018))
@@ -20,10 +22,12 @@ void SysTick_Init(void) {
 //
 void SysTick_Wait(unsigned long delay) {
   volatile unsigned long elapsedTime;
+  int state = Power_Enter(POWER_WAIT);
   unsigned long startTime = NVIC_ST_CURRENT_R;
   do {
     elapsedTime = (startTime - NVIC_ST_CURRENT_R) & 0x00FFFFFF;
   } while (elapsedTime <= delay);
+  Power_Enter(state);
 }
 
 // 800000 * 12.5ns is  10ms
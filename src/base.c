@@ -0,0 +1,513 @@
+/*
+ * File: base.c
+ * Description: Base mode. A single pass operator-precedence evaluator
+ *              over 64-bit integers (masked to the word size), and
+ *              table-driven conversion to HEX/DEC/OCT/BIN.
+ */
+
+#include "base.h"
+
+#include "SysTick.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BASE_MAX_EXPR 40
+#define BASE_MAX_STACK 16
+
+// Line 1 is the expression, line 2 the status, the rest the value
+#define BASE_VALUE_ROW ((LCD_ROWS > 2) ? 2 : 1)
+
+// Buffer tokens besides digits and single-character operators
+#define BASE_TOK_ANS '\x80' // Displays as "Ans"
+#define BASE_TOK_SHL '<'    // Displays as "<<"
+#define BASE_TOK_SHR '>'    // Displays as ">>"
+#define BASE_OP_NEG 'n'     // Unary minus (operator stack only)
+
+static const char g_digits[] = "0123456789ABCDEF";
+
+// Division-free decimal output: 10^19 .. 10^0
+static const uint64_t g_pow10[20] = {10000000000000000000ULL,
+                                     1000000000000000000ULL,
+                                     100000000000000000ULL,
+                                     10000000000000000ULL,
+                                     1000000000000000ULL,
+                                     100000000000000ULL,
+                                     10000000000000ULL,
+                                     1000000000000ULL,
+                                     100000000000ULL,
+                                     10000000000ULL,
+                                     1000000000ULL,
+                                     100000000ULL,
+                                     10000000ULL,
+                                     1000000ULL,
+                                     100000ULL,
+                                     10000ULL,
+                                     1000ULL,
+                                     100ULL,
+                                     10ULL,
+                                     1ULL};
+
+// Mode State
+static int g_base = 16;
+static int g_bits = 32;
+static int g_signed = 0;
+static int g_layer = 0; // 0=Off, 1=Shift, 2=A-F digits
+
+static char g_buf[BASE_MAX_EXPR + 1];
+static int g_len = 0;
+static uint64_t g_ans = 0;
+static int g_hasResult = 0; // Result on screen; next digit starts over
+
+// Evaluator stacks
+static uint64_t g_valStack[BASE_MAX_STACK];
+static char g_opStack[BASE_MAX_STACK];
+static int g_valTop;
+static int g_opTop;
+
+static uint64_t Base_Mask(void) {
+  return (g_bits == 64) ? ~0ULL : 0xFFFFFFFFULL;
+}
+
+// Sign-extend from the word size
+static int64_t Base_ToSigned(uint64_t v) {
+  return (g_bits == 64) ? (int64_t)v : (int64_t)(int32_t)(uint32_t)v;
+}
+
+static int Base_DigitValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Log2 of a power-of-two base, 0 for decimal
+static int Base_Shift(int base) {
+  return (base == 16) ? 4 : (base == 8) ? 3 : (base == 2) ? 1 : 0;
+}
+
+void Base_Format(uint64_t v, int base, int bits, int isSigned, char *out) {
+  int shift = Base_Shift(base);
+  int n = 0;
+  int k;
+
+  if (shift) {
+    // Bit slicing: one table lookup per digit, top group first
+    int group = (bits + shift - 1) / shift;
+    while (--group > 0 && ((v >> (group * shift)) & (base - 1)) == 0)
+      ; // Skip leading zeros
+    for (; group >= 0; group--)
+      out[n++] = g_digits[(v >> (group * shift)) & (base - 1)];
+    out[n] = '\0';
+    return;
+  }
+
+  if (isSigned && (bits == 64 ? (int64_t)v < 0 : (int32_t)(uint32_t)v < 0)) {
+    out[n++] = '-';
+    v = (0 - v) & ((bits == 64) ? ~0ULL : 0xFFFFFFFFULL);
+  }
+
+  // Count subtractions of each power of ten
+  for (k = 0; k < 20; k++) {
+    int d = 0;
+    while (v >= g_pow10[k]) {
+      v -= g_pow10[k];
+      d++;
+    }
+    if (d || n > (out[0] == '-') || k == 19)
+      out[n++] = g_digits[d];
+  }
+  out[n] = '\0';
+}
+
+// --- Evaluator ---
+
+static int Base_Precedence(char op) {
+  switch (op) {
+  case '|':
+    return 1;
+  case '^':
+    return 2;
+  case '&':
+    return 3;
+  case BASE_TOK_SHL:
+  case BASE_TOK_SHR:
+    return 4;
+  case '+':
+  case '-':
+    return 5;
+  case '*':
+  case '/':
+  case '%':
+    return 6;
+  case BASE_OP_NEG:
+  case '~':
+    return 7; // Unary
+  default:
+    return 0; // '('
+  }
+}
+
+static int Base_IsBinary(char c) {
+  return Base_Precedence(c) >= 1 && Base_Precedence(c) <= 6;
+}
+
+// Apply the top operator to the value stack (0 = OK, 1 = Error)
+static int Base_Reduce(void) {
+  char op = g_opStack[g_opTop--];
+  uint64_t mask = Base_Mask();
+  uint64_t a, b, r;
+
+  if (op == BASE_OP_NEG || op == '~') {
+    if (g_valTop < 0)
+      return 1;
+    a = g_valStack[g_valTop];
+    g_valStack[g_valTop] = ((op == '~') ? ~a : 0 - a) & mask;
+    return 0;
+  }
+
+  if (g_valTop < 1)
+    return 1;
+  b = g_valStack[g_valTop--];
+  a = g_valStack[g_valTop];
+
+  switch (op) {
+  case '+':
+    r = a + b;
+    break;
+  case '-':
+    r = a - b;
+    break;
+  case '*':
+    r = a * b;
+    break;
+  case '/':
+  case '%':
+    if (b == 0)
+      return 1; // Division by zero
+    if (g_signed) {
+      int64_t sa = Base_ToSigned(a);
+      int64_t sb = Base_ToSigned(b);
+      if (sb == -1)
+        r = (op == '/') ? 0 - a : 0; // Avoids INT64_MIN / -1
+      else
+        r = (uint64_t)((op == '/') ? sa / sb : sa % sb);
+    } else {
+      r = (op == '/') ? a / b : a % b;
+    }
+    break;
+  case '&':
+    r = a & b;
+    break;
+  case '|':
+    r = a | b;
+    break;
+  case '^':
+    r = a ^ b;
+    break;
+  case BASE_TOK_SHL:
+    r = (b >= (uint64_t)g_bits) ? 0 : a << b;
+    break;
+  case BASE_TOK_SHR:
+    if (g_signed) {
+      int64_t sa = Base_ToSigned(a);
+      r = (uint64_t)((b >= (uint64_t)g_bits) ? (sa < 0 ? -1 : 0) : sa >> b);
+    } else {
+      r = (b >= (uint64_t)g_bits) ? 0 : a >> b;
+    }
+    break;
+  default:
+    return 1;
+  }
+
+  g_valStack[g_valTop] = r & mask;
+  return 0;
+}
+
+// Evaluate g_buf. Returns 0 on success, 1 on error (errorPos = index)
+static int Base_Evaluate(uint64_t *out, int *errorPos) {
+  uint64_t mask = Base_Mask();
+  int shift = Base_Shift(g_base);
+  int expectOperand = 1;
+  int i = 0;
+
+  g_valTop = -1;
+  g_opTop = -1;
+
+  while (i < g_len) {
+    char c = g_buf[i];
+    int d = Base_DigitValue(c);
+
+    *errorPos = i;
+    if (expectOperand) {
+      if (d >= 0 || c == BASE_TOK_ANS) {
+        uint64_t v = g_ans;
+        if (g_valTop >= BASE_MAX_STACK - 1)
+          return 1;
+        if (c == BASE_TOK_ANS) {
+          i++;
+        } else {
+          // Literal in the current base, checked against the word size
+          v = 0;
+          while (i < g_len && (d = Base_DigitValue(g_buf[i])) >= 0) {
+            *errorPos = i;
+            if (d >= g_base)
+              return 1;
+            if (shift ? (v > (mask >> shift))
+                      : (v > (mask - (uint64_t)d) / 10))
+              return 1; // Does not fit
+            v = shift ? (v << shift) | (uint64_t)d : v * 10 + (uint64_t)d;
+            i++;
+          }
+        }
+        g_valStack[++g_valTop] = v;
+        expectOperand = 0;
+        continue;
+      }
+      if (c == '(' || c == '-' || c == '~') {
+        if (g_opTop >= BASE_MAX_STACK - 1)
+          return 1;
+        g_opStack[++g_opTop] = (c == '-') ? BASE_OP_NEG : c;
+      } else {
+        return 1; // Operator or ')' where a number belongs
+      }
+    } else if (c == ')') {
+      while (g_opTop >= 0 && g_opStack[g_opTop] != '(') {
+        if (Base_Reduce())
+          return 1;
+      }
+      if (g_opTop < 0)
+        return 1; // Unmatched ')'
+      g_opTop--;
+    } else if (Base_IsBinary(c)) {
+      int p = Base_Precedence(c);
+      while (g_opTop >= 0 && Base_Precedence(g_opStack[g_opTop]) >= p) {
+        if (Base_Reduce())
+          return 1;
+      }
+      if (g_opTop >= BASE_MAX_STACK - 1)
+        return 1;
+      g_opStack[++g_opTop] = c;
+      expectOperand = 1;
+    } else {
+      return 1; // Number or '(' directly after a value
+    }
+    i++;
+  }
+
+  *errorPos = g_len;
+  if (expectOperand)
+    return 1;
+  while (g_opTop >= 0) {
+    if (g_opStack[g_opTop] == '(' || Base_Reduce())
+      return 1; // Unclosed '(' or division by zero
+  }
+  *out = g_valStack[0];
+  return 0;
+}
+
+// --- Screen ---
+
+// Line 1: the end of the expression
+static void Base_DrawExpr(void) {
+  char line[24];
+  int width = 0;
+  int i = g_len;
+  int n = 0;
+
+  // Find the first token that still fits in 20 cells
+  while (i > 0) {
+    char c = g_buf[i - 1];
+    int w = (c == BASE_TOK_ANS)                        ? 3
+            : (c == BASE_TOK_SHL || c == BASE_TOK_SHR) ? 2
+                                                       : 1;
+    if (width + w > 20)
+      break;
+    width += w;
+    i--;
+  }
+
+  for (; i < g_len; i++) {
+    char c = g_buf[i];
+    if (c == BASE_TOK_ANS) {
+      memcpy(&line[n], "Ans", 3);
+      n += 3;
+    } else if (c == BASE_TOK_SHL || c == BASE_TOK_SHR) {
+      line[n++] = c;
+      line[n++] = c;
+    } else {
+      line[n++] = c;
+    }
+  }
+  line[n] = '\0';
+
+  lcdWriteRow(0, line);
+}
+
+// Line 2: base, word size and active layer
+static void Base_DrawStatus(void) {
+  static const char *const names[] = {"BIN", "OCT", "DEC", "HEX"};
+  const char *name = names[(g_base == 2)    ? 0
+                           : (g_base == 8)  ? 1
+                           : (g_base == 10) ? 2
+                                            : 3];
+  char line[24];
+
+  sprintf(line, "%s %d%c %10s", name, g_bits, g_signed ? 's' : 'u',
+          (g_layer == 1) ? "[Shift]" : (g_layer == 2) ? "[1-6:A-F]" : "");
+  if (LCD_ROWS > 2)
+    lcdWriteRow(1, line); // No room on two-line panels
+}
+
+// Lines 3-4 (line 2 on two-line panels): a value right-aligned, spilling
+// upwards if it is longer
+static void Base_DrawValue(uint64_t v) {
+  char digits[72];
+  char cells[LCD_ROWS * LCD_COLS];
+  const char *shown = digits;
+  int len;
+  int first;
+  int row;
+
+  Base_Format(v, g_base, g_bits, g_signed, digits);
+  len = (int)strlen(digits);
+  if (len > (int)sizeof(cells)) {
+    shown += len - (int)sizeof(cells); // Low digits only
+    len = (int)sizeof(cells);
+  }
+
+  memset(cells, ' ', sizeof(cells));
+  memcpy(&cells[sizeof(cells) - len], shown, len);
+
+  // The value lines are always redrawn; 64-bit BIN can use the whole panel
+  first = (int)sizeof(cells) - len;
+  if (first > BASE_VALUE_ROW * LCD_COLS)
+    first = BASE_VALUE_ROW * LCD_COLS;
+  row = first / LCD_COLS;
+  if (first % LCD_COLS) {
+    lcdWriteRect(row, first % LCD_COLS, LCD_COLS - first % LCD_COLS, 1,
+                 &cells[first]);
+    row++;
+  }
+  lcdWriteRect(row, 0, LCD_COLS, LCD_ROWS - row, &cells[row * LCD_COLS]);
+}
+
+static void Base_Draw(void) {
+  lcdClearScreen();
+  lcdCursorOff();
+  Base_DrawExpr();
+  Base_DrawStatus();
+  Base_DrawValue(g_ans);
+}
+
+static void Base_Insert(char c) {
+  if (g_hasResult) {
+    // Operators continue from the result, anything else starts over
+    g_len = 0;
+    if (Base_IsBinary(c))
+      g_buf[g_len++] = BASE_TOK_ANS;
+    g_hasResult = 0;
+    Base_DrawStatus(); // A long BIN result may have covered it
+  }
+  if (g_len < BASE_MAX_EXPR)
+    g_buf[g_len++] = c;
+  Base_DrawExpr();
+}
+
+static void Base_Run(void) {
+  uint64_t v;
+  int errorPos;
+  char line[24];
+
+  if (g_len == 0)
+    return;
+  if (Base_Evaluate(&v, &errorPos)) {
+    sprintf(line, "Error at %d", errorPos + 1);
+    lcdWriteRow(BASE_VALUE_ROW, line);
+    return;
+  }
+  g_ans = v;
+  g_hasResult = 1;
+  Base_DrawValue(v);
+}
+
+// Wait for the next key (released) and return its raw code
+static unsigned char Base_GetKey(void) {
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      while (readKeypad() != 0)
+        ; // Wait Release
+      return k;
+    }
+    SysTick_Wait10ms(5);
+  }
+}
+
+void Base_Show(void) {
+  Base_Draw();
+
+  while (1) {
+    unsigned char code = Base_GetKey();
+    char key = Key_Map(KEY_LAYER_BASE + g_layer, code);
+
+    if (key == KEY_ACT_SHIFT) {
+      // Off -> Shift -> A-F (hex only) -> Off
+      g_layer = (g_layer == 0) ? 1 : (g_layer == 1 && g_base == 16) ? 2 : 0;
+      Base_DrawStatus();
+      continue;
+    }
+
+    if (g_layer == 2 && key == KEY_NONE) {
+      // A-F stays on until D or a key outside the layer
+      key = Key_Map(KEY_LAYER_BASE, code);
+      g_layer = 0;
+      Base_DrawStatus();
+    } else if (g_layer == 1) {
+      g_layer = 0; // One key only
+      Base_DrawStatus();
+    }
+
+    switch (key) {
+    case KEY_NONE:
+      break;
+    case KEY_ACT_EXIT:
+      return;
+    case KEY_ACT_BASE:
+      // Next base: HEX -> DEC -> OCT -> BIN -> HEX
+      g_base = (g_base == 16)   ? 10
+               : (g_base == 10) ? 8
+               : (g_base == 8)  ? 2
+                                : 16;
+      g_len = 0;
+      Base_Draw();
+      break;
+    case KEY_ACT_WIDTH:
+      g_bits = (g_bits == 32) ? 64 : 32;
+      g_ans &= Base_Mask();
+      Base_Draw();
+      break;
+    case KEY_ACT_SIGN:
+      g_signed = !g_signed;
+      Base_Draw();
+      break;
+    case KEY_ACT_EVAL:
+      Base_Run();
+      break;
+    case KEY_ACT_BACK:
+      if (g_len > 0 && !g_hasResult)
+        g_len--;
+      Base_DrawExpr();
+      break;
+    default:
+      // Digits beyond the current base are ignored
+      if (Base_DigitValue(key) < g_base)
+        Base_Insert(key);
+      break;
+    }
+  }
+}
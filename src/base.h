@@ -0,0 +1,24 @@
+/*
+ * File: base.h
+ * Description: Public interface for Base mode (programmer calculator).
+ *              Integer expressions in HEX, DEC, OCT or BIN, evaluated in
+ *              32- or 64-bit signed or unsigned arithmetic.
+ */
+
+#ifndef BASE_H
+#define BASE_H
+
+#include <stdint.h>
+
+// Base mode screen
+// Keys: A:+ B:- C:* #:Evaluate *:Backspace D:Shift (twice: A-F layer)
+//       Sh+1:( Sh+2:) Sh+3:& Sh+4:| Sh+5:^ Sh+6:~ Sh+7:<< Sh+8:>> Sh+9:%
+//       Sh+C:/ Sh+0:Base Sh+A:32/64 bit Sh+B:Signed Sh+#:Exit
+//       A-F layer: 1-6 (or A-C) type A-F, other keys leave the layer
+void Base_Show(void);
+
+// Format v (already masked to 'bits') in 'base' (2, 8, 10 or 16).
+// Decimal uses a power-of-ten table instead of division.
+void Base_Format(uint64_t v, int base, int bits, int isSigned, char *out);
+
+#endif
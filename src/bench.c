@@ -0,0 +1,365 @@
+/*
+ * File: bench.c
+ * Description: On-target benchmarks. Cycle counts come from the DWT
+ *              counter (perf.c); accuracy is checked against the double
+ *              precision C library.
+ */
+
+#include "bench.h"
+
+#include "SysTick.h"
+#include "bignum.h"
+#include "expr.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "matrix.h"
+#include "password.h"
+#include "perf.h"
+#include "sci.h"
+#include "sha256.h"
+#include "stats.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_SAMPLES 64
+#define BENCH_MAX_ROWS 20
+#define BENCH_BIG_OPS 8  // Operations timed per big decimal row
+#define BENCH_MAT_OPS 32 // Multiplies timed per matrix row
+#define BENCH_IO_OPS 16  // LCD commands and keypad scans timed
+#define BENCH_VISIBLE 3 // Line 1 is the header
+
+// Key-to-result budget, well inside the 200 ms debounce
+#define BENCH_KEY_BUDGET_US 50000
+
+// Worst-case exact expression: 64 chars, 16 distinct prime denominators
+static const char g_frac64[] =
+    "1/7+2/9-3/11*4/13+5/17-6/19*7/23+8/29-9/31+1/37*2/41-3/43+4/47-1";
+
+static char g_rows[BENCH_MAX_ROWS][LCD_COLS + 1];
+static int g_numRows = 0;
+
+// Scientific Function Set
+typedef struct {
+  const char *name;
+  float (*fn)(float);
+  double (*ref)(double);
+  float lo; // Input sweep
+  float hi;
+} BenchSci;
+
+static const BenchSci g_sci[] = {
+    {"sqrt", Sci_Sqrt, sqrt, 0.0f, 1000.0f},
+    {"sin", Sci_Sin, sin, -64.0f, 64.0f},
+    {"cos", Sci_Cos, cos, -64.0f, 64.0f},
+    {"exp", Sci_Exp, exp, -80.0f, 80.0f},
+    {"ln", Sci_Ln, log, 0.001f, 1000.0f},
+};
+
+#define BENCH_NUM_SCI (int)(sizeof(g_sci) / sizeof(g_sci[0]))
+
+// Size of one float ULP at the magnitude of v
+static double Bench_Ulp(float v) {
+  float a = fabsf(v);
+  uint32_t u;
+  float next;
+
+  if (a < 1.17549435e-38f)
+    a = 1.17549435e-38f; // Smallest normal
+  memcpy(&u, &a, sizeof(u));
+  u++;
+  memcpy(&next, &u, sizeof(next));
+  return (double)next - (double)a;
+}
+
+static void Bench_AddRow(const char *text) {
+  if (g_numRows < BENCH_MAX_ROWS) {
+    strncpy(g_rows[g_numRows], text, LCD_COLS);
+    g_rows[g_numRows][LCD_COLS] = '\0';
+    g_numRows++;
+  }
+}
+
+// Cycles per call and worst ULP error for each scientific function
+static void Bench_RunSci(void) {
+  float xs[BENCH_SAMPLES];
+  volatile float sink;
+  char line[24];
+  int f, i;
+
+  for (f = 0; f < BENCH_NUM_SCI; f++) {
+    const BenchSci *b = &g_sci[f];
+    unsigned long start;
+    unsigned long cycles;
+    double worst = 0.0;
+
+    for (i = 0; i < BENCH_SAMPLES; i++)
+      xs[i] = b->lo + (b->hi - b->lo) * i / (BENCH_SAMPLES - 1);
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_SAMPLES; i++)
+      sink = b->fn(xs[i]);
+    cycles = Perf_Cycles() - start;
+    (void)sink;
+
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+      double ref = b->ref(xs[i]);
+      double err = fabs(b->fn(xs[i]) - ref) / Bench_Ulp((float)ref);
+      if (err > worst)
+        worst = err;
+    }
+
+    sprintf(line, "%-5s %5lu %7.2f", b->name, cycles / BENCH_SAMPLES, worst);
+    Bench_AddRow(line);
+  }
+}
+
+// Compile and evaluate the worst-case expression exactly, as '#' would
+static void Bench_RunFrac(void) {
+  static ExprProgram prog; // Too big for the stack
+  static const Rational vars[EXPR_NUM_VARS]; // No exact variables
+  Rational r;
+  unsigned long start;
+  unsigned long us;
+  int errorPos;
+  int exact = 0;
+  char line[24];
+
+  start = Perf_Cycles();
+  if (Expr_Compile(g_frac64, sizeof(g_frac64) - 1, &prog, &errorPos) == 0)
+    exact = (Expr_RunRational(&prog, vars, &r) == 0);
+  us = (Perf_Cycles() - start) / PERF_CYCLES_PER_US;
+
+  sprintf(line, "frac64 %7luus %s", us,
+          !exact ? "ovf" : (us <= BENCH_KEY_BUDGET_US) ? "ok" : "slow");
+  Bench_AddRow(line);
+}
+
+// Hash work done under one PIN digit key, and the whole PIN at '#'
+static void Bench_RunPin(void) {
+  static const uint8_t salt[PASSWORD_SALT_BYTES];
+  uint8_t hash[SHA256_BYTES];
+  unsigned long start;
+  unsigned long us;
+  char line[24];
+
+  start = Perf_Cycles();
+  Password_Hash("1234", salt, PASSWORD_KEY_ROUNDS, hash);
+  us = (Perf_Cycles() - start) / PERF_CYCLES_PER_US / 4;
+
+  sprintf(line, "pin/key %6luus %s", us,
+          (us <= BENCH_KEY_BUDGET_US) ? "ok" : "slow");
+  Bench_AddRow(line);
+
+  start = Perf_Cycles();
+  Password_Hash("1234", salt, PASSWORD_ROUNDS, hash);
+  us = (Perf_Cycles() - start) / PERF_CYCLES_PER_US;
+
+  sprintf(line, "pin/all %6luus", us);
+  Bench_AddRow(line);
+}
+
+// Cycles per LCD command byte (both nibbles, EN pulses and the 37 us
+// execution wait) and per 4-row keypad scan with no key down
+static void Bench_RunIo(void) {
+  unsigned long start;
+  unsigned long lcd, scan;
+  char line[24];
+  int i;
+
+  start = Perf_Cycles();
+  for (i = 0; i < BENCH_IO_OPS; i++)
+    lcdWriteCommand(0x0C); // Display on, cursor off: as it already is
+  lcd = (Perf_Cycles() - start) / BENCH_IO_OPS;
+
+  start = Perf_Cycles();
+  for (i = 0; i < BENCH_IO_OPS; i++)
+    readKeypad();
+  scan = (Perf_Cycles() - start) / BENCH_IO_OPS;
+
+  sprintf(line, "lcd/cmd %7lucy", lcd);
+  Bench_AddRow(line);
+  sprintf(line, "kpd/scan %6lucy", scan);
+  Bench_AddRow(line);
+}
+
+#if STATS_LOG_SIZE > 0
+// Cycles to undo with a full sample log, and whether undo gives back the
+// totals of the samples before it exactly
+static void Bench_RunStats(void) {
+  static double ys[STATS_LOG_SIZE];
+  StatsAcc s;
+  unsigned long start;
+  unsigned long cycles;
+  char line[24];
+  int ok;
+  int i;
+
+  for (i = 0; i < STATS_LOG_SIZE; i++)
+    ys[i] = (i & 1) ? 123456.7 : 1.0;
+
+  // 1, 123456.7, Undo: a float log used to leave a mean of 0.996875
+  Stats_Rebuild(&s, ys, 2);
+  Stats_Rebuild(&s, ys, 1);
+  ok = (s.n == 1 && s.sum == 1.0 && s.mean == 1.0 && s.m2 == 0.0 &&
+        s.min == 1.0 && s.max == 1.0);
+
+  start = Perf_Cycles();
+  Stats_Rebuild(&s, ys, STATS_LOG_SIZE - 1);
+  cycles = Perf_Cycles() - start;
+
+  sprintf(line, "undo %8lucy %s", cycles, ok ? "ok" : "bad");
+  Bench_AddRow(line);
+}
+#endif
+
+#if BIG_MAX_DIGITS > 0
+// Cycles per add, multiply and divide at 20, 40 and 80 digits
+static void Bench_RunBig(void) {
+  static const int digits[] = {20, 40, 80};
+  BigDec a, b, r, seven;
+  char line[24];
+  int d, i;
+
+  Bench_AddRow("dig  add   mul   div");
+
+  for (d = 0; d < 3; d++) {
+    unsigned long start;
+    unsigned long add, mul, div;
+
+    if (digits[d] > BIG_MAX_DIGITS)
+      break;
+    Big_SetDigits(digits[d]);
+
+    // Full-length operands: 1/7 and 2/7
+    Big_FromInt(1, &a);
+    Big_FromInt(7, &seven);
+    Big_Div(&a, &seven, &a);
+    Big_Add(&a, &a, &b);
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_BIG_OPS; i++)
+      Big_Add(&a, &b, &r);
+    add = (Perf_Cycles() - start) / BENCH_BIG_OPS;
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_BIG_OPS; i++)
+      Big_Mul(&a, &b, &r);
+    mul = (Perf_Cycles() - start) / BENCH_BIG_OPS;
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_BIG_OPS; i++)
+      Big_Div(&a, &b, &r);
+    div = (Perf_Cycles() - start) / BENCH_BIG_OPS;
+
+    sprintf(line, "%2d%6lu%6lu%6lu", digits[d], add, mul, div);
+    Bench_AddRow(line);
+  }
+}
+#endif
+
+// Textbook triple loop with a run-time size: the baseline for the
+// specialized kernels
+static void Bench_MatMulNaive(const float *a, const float *b, float *c,
+                              int n) {
+  int i, j, k;
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++) {
+      float s = 0.0f;
+      for (k = 0; k < n; k++)
+        s += a[i * n + k] * b[k * n + j];
+      c[i * n + j] = s;
+    }
+  }
+}
+
+// Cycles per matrix multiply, specialized kernel vs naive loop
+static void Bench_RunMat(void) {
+  static Matrix a, b, c;
+  char line[24];
+  int n, i;
+
+  Bench_AddRow("mat   fast   naive");
+
+  for (n = 2; n <= MAT_MAX; n++) {
+    unsigned long start;
+    unsigned long fast, naive;
+
+    a.n = n;
+    b.n = n;
+    for (i = 0; i < n * n; i++) {
+      a.m[i] = 1.0f + 0.25f * i;
+      b.m[i] = 2.0f - 0.125f * i;
+    }
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_MAT_OPS; i++)
+      Mat_Mul(&a, &b, &c);
+    fast = (Perf_Cycles() - start) / BENCH_MAT_OPS;
+
+    start = Perf_Cycles();
+    for (i = 0; i < BENCH_MAT_OPS; i++)
+      Bench_MatMulNaive(a.m, b.m, c.m, n);
+    naive = (Perf_Cycles() - start) / BENCH_MAT_OPS;
+
+    sprintf(line, "%dx%d%7lu%8lu", n, n, fast, naive);
+    Bench_AddRow(line);
+  }
+}
+
+static void Bench_Draw(int first) {
+  int r;
+
+  lcdClearScreen();
+  printDisplay("Fn    cyc/op    ulp");
+
+  for (r = 0; r < BENCH_VISIBLE && first + r < g_numRows; r++) {
+    lcdSetCursor(r + 1, 0);
+    printDisplay(g_rows[first + r]);
+  }
+}
+
+void Bench_Show(void) {
+  int first = 0;
+
+  lcdClearScreen();
+  lcdCursorOff();
+  printDisplay("Benchmarking...");
+
+  g_numRows = 0;
+  Bench_RunSci();
+  Bench_RunFrac();
+  Bench_RunPin();
+  Bench_RunIo();
+#if STATS_LOG_SIZE > 0
+  Bench_RunStats();
+#endif
+#if BIG_MAX_DIGITS > 0
+  Bench_RunBig();
+#endif
+  Bench_RunMat();
+
+  Bench_Draw(first);
+
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(KEY_LAYER_PAGER, k);
+
+      // Wait for release
+      while (readKeypad() != 0)
+        ;
+
+      if (c == KEY_ACT_EXIT)
+        return;
+      if (c == KEY_ACT_NEXT && first + BENCH_VISIBLE < g_numRows)
+        Bench_Draw(++first);
+      if (c == KEY_ACT_PREV && first > 0)
+        Bench_Draw(--first);
+    }
+    SysTick_Wait10ms(5);
+  }
+}
@@ -0,0 +1,13 @@
+/*
+ * File: bench.h
+ * Description: Public interface for the on-target benchmark screens.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+// Runs the benchmarks and shows results 3 rows at a time
+// Keys: #:Down *:Up 0:Exit
+void Bench_Show(void);
+
+#endif
@@ -0,0 +1,645 @@
+/*
+ * File: bignum.c
+ * Description: Fixed-capacity big decimal arithmetic.
+ *              Values live in fixed-size BigDec structs; temporaries for
+ *              products and Karatsuba come from a static bump arena, so
+ *              nothing is ever taken from the heap.
+ */
+
+#include "bignum.h"
+
+#if BIG_MAX_DIGITS > 0
+
+#define BIG_EXP_MAX 8000                 // |exp| limit (10^32000)
+#define BIG_ARENA_LIMBS (10 * BIG_LIMBS) // Scratch for one operation
+
+static int g_n = BIG_LIMBS; // Active limbs (working precision + guard)
+
+static uint16_t g_arena[BIG_ARENA_LIMBS];
+static int g_arenaTop = 0;
+
+// --- Arena ---
+
+// Returns 0 if the arena is exhausted
+static uint16_t *Big_Alloc(int limbs) {
+  uint16_t *p;
+  if (g_arenaTop + limbs > BIG_ARENA_LIMBS)
+    return 0;
+  p = &g_arena[g_arenaTop];
+  g_arenaTop += limbs;
+  return p;
+}
+
+// --- Limb Array Helpers ---
+
+// dst[0..dn) += src[0..sn), carry stops at dn
+static void Big_AddTo(uint16_t *dst, int dn, const uint16_t *src, int sn) {
+  uint32_t carry = 0;
+  int i;
+  for (i = 0; i < dn && (i < sn || carry); i++) {
+    uint32_t t = dst[i] + carry + ((i < sn) ? src[i] : 0);
+    carry = (t >= BIG_BASE);
+    dst[i] = (uint16_t)(carry ? t - BIG_BASE : t);
+  }
+}
+
+// dst[0..dn) -= src[0..sn), caller guarantees dst >= src
+static void Big_SubFrom(uint16_t *dst, int dn, const uint16_t *src, int sn) {
+  int32_t borrow = 0;
+  int i;
+  for (i = 0; i < dn && (i < sn || borrow); i++) {
+    int32_t t = (int32_t)dst[i] - borrow - ((i < sn) ? src[i] : 0);
+    borrow = (t < 0);
+    dst[i] = (uint16_t)(borrow ? t + BIG_BASE : t);
+  }
+}
+
+static void Big_Clear(uint16_t *p, int n) {
+  while (n-- > 0)
+    *p++ = 0;
+}
+
+static void Big_MulSchool(const uint16_t *a, const uint16_t *b, int n,
+                          uint16_t *out) {
+  int i, j;
+
+  Big_Clear(out, 2 * n);
+  for (i = 0; i < n; i++) {
+    uint32_t carry = 0;
+    if (a[i] == 0)
+      continue;
+    for (j = 0; j < n; j++) {
+      uint32_t t = out[i + j] + (uint32_t)a[i] * b[j] + carry;
+      out[i + j] = (uint16_t)(t % BIG_BASE);
+      carry = t / BIG_BASE;
+    }
+    out[i + n] = (uint16_t)carry;
+  }
+}
+
+// out[0..2n) = a[0..n) * b[0..n)
+// (a0 + a1 B)(b0 + b1 B) = z0 + (z1 - z0 - z2) B + z2 B^2
+static void Big_MulKara(const uint16_t *a, const uint16_t *b, int n,
+                        uint16_t *out) {
+  int h = n / 2;
+  int hi = n - h;
+  int mark = g_arenaTop;
+  uint16_t *sa = 0;
+  uint16_t *sb = 0;
+  uint16_t *z1 = 0;
+
+  if (n >= BIG_KARATSUBA_LIMBS) {
+    sa = Big_Alloc(hi + 1);
+    sb = Big_Alloc(hi + 1);
+    z1 = Big_Alloc(2 * hi + 2);
+  }
+  if (!z1) {
+    g_arenaTop = mark;
+    Big_MulSchool(a, b, n, out);
+    return;
+  }
+
+  Big_MulKara(a, b, h, out);                   // z0
+  Big_MulKara(a + h, b + h, hi, out + 2 * h);  // z2
+
+  // sa = a0 + a1, sb = b0 + b1
+  Big_Clear(sa, hi + 1);
+  Big_Clear(sb, hi + 1);
+  Big_AddTo(sa, hi + 1, a, h);
+  Big_AddTo(sa, hi + 1, a + h, hi);
+  Big_AddTo(sb, hi + 1, b, h);
+  Big_AddTo(sb, hi + 1, b + h, hi);
+
+  Big_MulKara(sa, sb, hi + 1, z1);
+  Big_SubFrom(z1, 2 * hi + 2, out, 2 * h);
+  Big_SubFrom(z1, 2 * hi + 2, out + 2 * h, 2 * hi);
+
+  // The top limbs of z1 are zero past 2n - h
+  Big_AddTo(out + h, 2 * n - h, z1, 2 * hi + 2);
+
+  g_arenaTop = mark;
+}
+
+// --- Normalization ---
+
+static void Big_Zero(BigDec *out) {
+  out->sign = 0;
+  out->exp = 0;
+  Big_Clear(out->limb, BIG_LIMBS);
+}
+
+// Round t[0..len) (value t * 10000^exp) into g_n limbs
+// Returns 0 on success, 1 on exponent overflow
+static int Big_Normalize(const uint16_t *t, int len, int exp, int sign,
+                         BigDec *out) {
+  int n = g_n;
+  int k = len - 1;
+  int i;
+
+  while (k >= 0 && t[k] == 0)
+    k--;
+  if (k < 0) {
+    Big_Zero(out);
+    return 0;
+  }
+
+  Big_Clear(out->limb, BIG_LIMBS);
+
+  if (k + 1 >= n) {
+    int drop = k + 1 - n;
+    for (i = 0; i < n; i++)
+      out->limb[i] = t[drop + i];
+    exp += drop;
+
+    // Round half up on the first dropped limb
+    if (drop > 0 && t[drop - 1] >= BIG_BASE / 2) {
+      i = 0;
+      while (i < n && out->limb[i] == BIG_BASE - 1)
+        out->limb[i++] = 0;
+      if (i < n) {
+        out->limb[i]++;
+      } else {
+        out->limb[n - 1] = 1; // 9999..9 rounded up to 1 0000..0
+        exp++;
+      }
+    }
+  } else {
+    int shift = n - 1 - k;
+    for (i = 0; i <= k; i++)
+      out->limb[shift + i] = t[i];
+    exp -= shift;
+  }
+
+  if (exp > BIG_EXP_MAX || exp < -BIG_EXP_MAX)
+    return 1;
+
+  out->exp = (short)exp;
+  out->sign = (signed char)sign;
+  return 0;
+}
+
+// --- Public Interface ---
+
+void Big_SetDigits(int digits) {
+  if (digits < 1)
+    digits = 1;
+  if (digits > BIG_MAX_DIGITS)
+    digits = BIG_MAX_DIGITS;
+  g_n = (digits + BIG_BASE_DIGITS - 1) / BIG_BASE_DIGITS + 1;
+}
+
+int Big_GetDigits(void) { return (g_n - 1) * BIG_BASE_DIGITS; }
+
+void Big_FromInt(int32_t v, BigDec *out) {
+  uint16_t t[3];
+  uint32_t m = (v < 0) ? (uint32_t)(-(v + 1)) + 1 : (uint32_t)v;
+
+  t[0] = (uint16_t)(m % BIG_BASE);
+  t[1] = (uint16_t)((m / BIG_BASE) % BIG_BASE);
+  t[2] = (uint16_t)(m / BIG_BASE / BIG_BASE);
+  Big_Normalize(t, 3, 0, (v < 0) ? -1 : 1, out);
+}
+
+int Big_FromDigits(const char *s, int len, BigDec *out) {
+  int intDigits = 0;
+  int fracDigits = 0;
+  int seenDot = 0;
+  int padFrac, padLeft, total, limbs;
+  int i, k;
+  int mark = g_arenaTop;
+  uint16_t *t;
+  int status;
+
+  for (i = 0; i < len; i++) {
+    if (s[i] == '.') {
+      if (seenDot)
+        return 1;
+      seenDot = 1;
+    } else if (s[i] >= '0' && s[i] <= '9') {
+      if (seenDot)
+        fracDigits++;
+      else
+        intDigits++;
+    } else {
+      return 1;
+    }
+  }
+  if (intDigits + fracDigits == 0)
+    return 1;
+
+  // Align both ends of the digit string to whole limbs
+  padFrac = (BIG_BASE_DIGITS - fracDigits % BIG_BASE_DIGITS) % BIG_BASE_DIGITS;
+  total = intDigits + fracDigits + padFrac;
+  padLeft = (BIG_BASE_DIGITS - total % BIG_BASE_DIGITS) % BIG_BASE_DIGITS;
+  limbs = (total + padLeft) / BIG_BASE_DIGITS;
+
+  t = Big_Alloc(limbs);
+  if (!t)
+    return 1;
+  Big_Clear(t, limbs);
+
+  // Digit k (0 = most significant, after left padding)
+  k = padLeft;
+  for (i = 0; i < len; i++) {
+    if (s[i] == '.')
+      continue;
+    t[limbs - 1 - k / BIG_BASE_DIGITS] =
+        (uint16_t)(t[limbs - 1 - k / BIG_BASE_DIGITS] * 10 + (s[i] - '0'));
+    k++;
+  }
+  for (; k < total + padLeft; k++) // Trailing fraction padding
+    t[limbs - 1 - k / BIG_BASE_DIGITS] *= 10;
+
+  status = Big_Normalize(t, limbs, -(fracDigits + padFrac) / BIG_BASE_DIGITS,
+                         1, out);
+  g_arenaTop = mark;
+  return status;
+}
+
+void Big_FromDouble(double v, BigDec *out) {
+  uint16_t t[5];
+  int e = 0;
+  int sign = 1;
+  int i;
+
+  if (v == 0.0 || v != v) {
+    Big_Zero(out);
+    return;
+  }
+  if (v < 0) {
+    sign = -1;
+    v = -v;
+  }
+
+  // Scale into [1, 10000)
+  while (v >= BIG_BASE) {
+    v /= BIG_BASE;
+    e++;
+  }
+  while (v < 1.0) {
+    v *= BIG_BASE;
+    e--;
+  }
+
+  // 5 limbs cover the 17 significant digits of a double
+  for (i = 4; i >= 0; i--) {
+    uint16_t d = (uint16_t)v;
+    t[i] = d;
+    v = (v - d) * BIG_BASE;
+  }
+  Big_Normalize(t, 5, e - 4, sign, out);
+}
+
+double Big_ToDouble(const BigDec *a) {
+  double r = 0.0;
+  int i;
+  int lo = (g_n > 5) ? g_n - 5 : 0;
+  int e;
+
+  for (i = g_n - 1; i >= lo; i--)
+    r = r * BIG_BASE + a->limb[i];
+
+  for (e = a->exp + lo; e > 0; e--)
+    r *= BIG_BASE;
+  for (; e < 0; e++)
+    r /= BIG_BASE;
+
+  return a->sign * r;
+}
+
+// Compare magnitudes: -1, 0, 1
+static int Big_CmpMag(const BigDec *a, const BigDec *b) {
+  int i;
+
+  if (a->exp != b->exp)
+    return (a->exp > b->exp) ? 1 : -1;
+  for (i = g_n - 1; i >= 0; i--) {
+    if (a->limb[i] != b->limb[i])
+      return (a->limb[i] > b->limb[i]) ? 1 : -1;
+  }
+  return 0;
+}
+
+// Place a's limbs into t, where t[0] has weight 10000^base
+static void Big_Place(const BigDec *a, uint16_t *t, int base) {
+  int i;
+  for (i = 0; i < g_n; i++) {
+    int pos = a->exp + i - base;
+    if (pos >= 0)
+      t[pos] = a->limb[i];
+  }
+}
+
+// |a| +/- |b| with |a| >= |b| when subtracting
+static int Big_AddMag(const BigDec *a, const BigDec *b, int subtract,
+                      int sign, BigDec *out) {
+  int hiExp = (a->exp > b->exp) ? a->exp : b->exp;
+  int loExp = (a->exp < b->exp) ? a->exp : b->exp;
+  int base, len;
+  int mark = g_arenaTop;
+  uint16_t *ta;
+  uint16_t *tb;
+  int status;
+
+  // One guard limb below the shorter operand is enough for rounding
+  base = (loExp > hiExp - g_n - 1) ? loExp : hiExp - g_n - 1;
+  len = hiExp + g_n + 1 - base;
+
+  ta = Big_Alloc(len);
+  tb = Big_Alloc(len);
+  if (!tb) {
+    g_arenaTop = mark;
+    return 1;
+  }
+  Big_Clear(ta, len);
+  Big_Clear(tb, len);
+  Big_Place(a, ta, base);
+  Big_Place(b, tb, base);
+
+  if (subtract)
+    Big_SubFrom(ta, len, tb, len);
+  else
+    Big_AddTo(ta, len, tb, len);
+
+  status = Big_Normalize(ta, len, base, sign, out);
+  g_arenaTop = mark;
+  return status;
+}
+
+int Big_Add(const BigDec *a, const BigDec *b, BigDec *out) {
+  int cmp;
+
+  if (b->sign == 0) {
+    *out = *a;
+    return 0;
+  }
+  if (a->sign == 0) {
+    *out = *b;
+    return 0;
+  }
+  if (a->sign == b->sign)
+    return Big_AddMag(a, b, 0, a->sign, out);
+
+  cmp = Big_CmpMag(a, b);
+  if (cmp == 0) {
+    Big_Zero(out);
+    return 0;
+  }
+  if (cmp > 0)
+    return Big_AddMag(a, b, 1, a->sign, out);
+  return Big_AddMag(b, a, 1, b->sign, out);
+}
+
+int Big_Sub(const BigDec *a, const BigDec *b, BigDec *out) {
+  BigDec nb = *b;
+  nb.sign = (signed char)-nb.sign;
+  return Big_Add(a, &nb, out);
+}
+
+int Big_Mul(const BigDec *a, const BigDec *b, BigDec *out) {
+  int mark = g_arenaTop;
+  uint16_t *p;
+  int status;
+
+  if (a->sign == 0 || b->sign == 0) {
+    Big_Zero(out);
+    return 0;
+  }
+
+  p = Big_Alloc(2 * g_n);
+  if (!p)
+    return 1;
+  Big_MulKara(a->limb, b->limb, g_n, p);
+  status = Big_Normalize(p, 2 * g_n, a->exp + b->exp, a->sign * b->sign, out);
+  g_arenaTop = mark;
+  return status;
+}
+
+// Long division, one base-10000 quotient limb at a time. Each limb is
+// estimated from the top three remainder limbs over the top two divisor
+// limbs, then corrected, so the quotient is exact to one limb past the
+// working precision and Big_Normalize rounds it like any other result.
+int Big_Div(const BigDec *a, const BigDec *b, BigDec *out) {
+  int n = g_n;
+  int len = 2 * n + 2;
+  int mark = g_arenaTop;
+  const uint16_t *d = b->limb;
+  uint32_t dTop;
+  uint16_t *r;
+  uint16_t *q;
+  int i, j;
+  int status;
+
+  if (b->sign == 0)
+    return 1;
+  if (a->sign == 0) {
+    Big_Zero(out);
+    return 0;
+  }
+
+  // r = |a| * 10000^(n + 1), with a zero limb on top
+  r = Big_Alloc(len);
+  q = Big_Alloc(n + 2);
+  if (!q) {
+    g_arenaTop = mark;
+    return 1;
+  }
+  Big_Clear(r, len);
+  for (i = 0; i < n; i++)
+    r[n + 1 + i] = a->limb[i];
+
+  dTop = (uint32_t)d[n - 1] * BIG_BASE + d[n - 2];
+
+  // r[j..j+n] < d * 10000 holds before every step
+  for (j = n + 1; j >= 0; j--) {
+    uint64_t top = ((uint64_t)r[j + n] * BIG_BASE + r[j + n - 1]) * BIG_BASE +
+                   r[j + n - 2];
+    uint32_t qhat = (uint32_t)(top / dTop);
+    uint32_t carry = 0;
+    int32_t borrow = 0;
+    int32_t hi;
+
+    if (qhat > BIG_BASE - 1)
+      qhat = BIG_BASE - 1;
+
+    // r[j..j+n] -= qhat * d
+    for (i = 0; i < n; i++) {
+      uint32_t p = qhat * d[i] + carry;
+      int32_t t = (int32_t)r[j + i] - (int32_t)(p % BIG_BASE) - borrow;
+      carry = p / BIG_BASE;
+      borrow = (t < 0);
+      r[j + i] = (uint16_t)(borrow ? t + BIG_BASE : t);
+    }
+    hi = (int32_t)r[j + n] - (int32_t)carry - borrow;
+
+    // Estimate too big: add d back
+    while (hi < 0) {
+      carry = 0;
+      for (i = 0; i < n; i++) {
+        uint32_t t = r[j + i] + d[i] + carry;
+        carry = (t >= BIG_BASE);
+        r[j + i] = (uint16_t)(carry ? t - BIG_BASE : t);
+      }
+      hi += (int32_t)carry;
+      qhat--;
+    }
+    r[j + n] = (uint16_t)hi;
+
+    // Estimate too small: take d off again
+    while (1) {
+      int cmp = (r[j + n] != 0);
+      for (i = n - 1; i >= 0 && !cmp; i--) {
+        if (r[j + i] != d[i])
+          cmp = (r[j + i] > d[i]) ? 1 : -1;
+      }
+      if (cmp < 0)
+        break;
+      Big_SubFrom(&r[j], n + 1, d, n);
+      qhat++;
+    }
+
+    q[j] = (uint16_t)qhat;
+  }
+
+  // Both exponent bounds are checked here
+  status = Big_Normalize(q, n + 2, a->exp - b->exp - (n + 1),
+                         a->sign * b->sign, out);
+  g_arenaTop = mark;
+  return status;
+}
+
+int Big_Pow(const BigDec *a, const BigDec *b, BigDec *out) {
+  BigDec res, base;
+  double e;
+  long n;
+  int i;
+
+  // Exponent must be an integer below 10^8
+  for (i = 0; i < g_n && b->exp + i < 0; i++) {
+    if (b->limb[i] != 0)
+      return 1;
+  }
+  e = Big_ToDouble(b);
+  if (e > 1e8 || e < -1e8)
+    return 1;
+  n = (long)e;
+
+  Big_FromInt(1, &res);
+  base = *a;
+  i = (n < 0);
+  if (i)
+    n = -n;
+
+  // Square and multiply
+  while (n > 0) {
+    if ((n & 1) && Big_Mul(&res, &base, &res))
+      return 1;
+    n >>= 1;
+    if (n > 0 && Big_Mul(&base, &base, &base))
+      return 1;
+  }
+
+  if (i) {
+    BigDec one;
+    Big_FromInt(1, &one);
+    return Big_Div(&one, &res, out);
+  }
+  *out = res;
+  return 0;
+}
+
+void Big_Format(const BigDec *a, int sigDigits, char *out) {
+  char digits[4 * BIG_LIMBS + 2];
+  int nd = 0;
+  int pointPos;
+  int i;
+  int lead = 1;
+
+  if (a->sign == 0) {
+    out[0] = '0';
+    out[1] = '\0';
+    return;
+  }
+
+  // Mantissa digits without leading zeros
+  for (i = g_n - 1; i >= 0; i--) {
+    int d;
+    int div = 1000;
+    for (d = 0; d < BIG_BASE_DIGITS; d++) {
+      char c = (char)('0' + (a->limb[i] / div) % 10);
+      div /= 10;
+      if (lead && c == '0')
+        continue;
+      lead = 0;
+      digits[nd++] = c;
+    }
+  }
+  pointPos = nd + BIG_BASE_DIGITS * a->exp; // Digits before the point
+
+  // Round to sigDigits
+  if (nd > sigDigits) {
+    int round = (digits[sigDigits] >= '5');
+    nd = sigDigits;
+    for (i = nd - 1; round && i >= 0; i--) {
+      if (digits[i] == '9') {
+        digits[i] = '0';
+      } else {
+        digits[i]++;
+        round = 0;
+      }
+    }
+    if (round) { // 999 -> 1000
+      digits[0] = '1';
+      nd = 1;
+      pointPos++;
+    }
+  }
+
+  while (nd > 1 && digits[nd - 1] == '0')
+    nd--;
+
+  if (a->sign < 0)
+    *out++ = '-';
+
+  if (pointPos > sigDigits || pointPos < -4) {
+    // d.dddE+x
+    *out++ = digits[0];
+    if (nd > 1) {
+      *out++ = '.';
+      for (i = 1; i < nd; i++)
+        *out++ = digits[i];
+    }
+    *out++ = 'E';
+    i = pointPos - 1;
+    if (i < 0) {
+      *out++ = '-';
+      i = -i;
+    }
+    {
+      char exps[8];
+      int ne = 0;
+      do {
+        exps[ne++] = (char)('0' + i % 10);
+        i /= 10;
+      } while (i > 0);
+      while (ne > 0)
+        *out++ = exps[--ne];
+    }
+  } else if (pointPos <= 0) {
+    *out++ = '0';
+    *out++ = '.';
+    for (i = pointPos; i < 0; i++)
+      *out++ = '0';
+    for (i = 0; i < nd; i++)
+      *out++ = digits[i];
+  } else {
+    for (i = 0; i < nd || i < pointPos; i++) {
+      if (i == pointPos)
+        *out++ = '.';
+      *out++ = (i < nd) ? digits[i] : '0';
+    }
+  }
+  *out = '\0';
+}
+
+#endif /* BIG_MAX_DIGITS */
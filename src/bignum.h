@@ -0,0 +1,62 @@
+/*
+ * File: bignum.h
+ * Description: Public interface for the fixed-capacity big decimal engine.
+ *              Floating point in base 10000: sign, limb exponent and a
+ *              normalized mantissa of up to BIG_LIMBS limbs.
+ */
+
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include <stdint.h>
+
+// Compile-time capacity: RAM grows linearly with digits (0 disables).
+// Each value costs 2 bytes per 4 digits; the scratch arena 10x that.
+#ifndef BIG_MAX_DIGITS
+#define BIG_MAX_DIGITS 80
+#endif
+
+#if BIG_MAX_DIGITS > 0
+
+#define BIG_BASE 10000
+#define BIG_BASE_DIGITS 4
+#define BIG_LIMBS ((BIG_MAX_DIGITS + 3) / 4 + 1) // +1 guard limb
+
+// Karatsuba takes over from schoolbook at this many limbs
+#define BIG_KARATSUBA_LIMBS 12
+
+typedef struct {
+  signed char sign; // 1, -1, or 0 for zero
+  short exp;        // value = sum(limb[i] * 10000^(i + exp))
+  uint16_t limb[BIG_LIMBS]; // Little endian, limb[n-1] != 0 unless zero
+} BigDec;
+
+// Working precision in digits (clamped to BIG_MAX_DIGITS).
+// All values in one calculation must share the same precision.
+void Big_SetDigits(int digits);
+int Big_GetDigits(void);
+
+void Big_FromInt(int32_t v, BigDec *out);
+
+// Parse a decimal literal (digits and at most one '.')
+// Returns 0 on success, 1 on bad input
+int Big_FromDigits(const char *s, int len, BigDec *out);
+
+void Big_FromDouble(double v, BigDec *out);
+double Big_ToDouble(const BigDec *a);
+
+// Arithmetic: returns 0 on success, 1 on exponent overflow or a
+// division by zero
+int Big_Add(const BigDec *a, const BigDec *b, BigDec *out);
+int Big_Sub(const BigDec *a, const BigDec *b, BigDec *out);
+int Big_Mul(const BigDec *a, const BigDec *b, BigDec *out);
+int Big_Div(const BigDec *a, const BigDec *b, BigDec *out);
+int Big_Pow(const BigDec *a, const BigDec *b, BigDec *out); // Integer b
+
+// Format with at most sigDigits significant digits, trailing zeros
+// removed; large or tiny values use E notation. out needs sigDigits + 12
+void Big_Format(const BigDec *a, int sigDigits, char *out);
+
+#endif /* BIG_MAX_DIGITS */
+
+#endif /* BIGNUM_H_ */
@@ -1,363 +1,767 @@
 /*
  * File: calculator.c
  * Description: Calculator Core Implementation.
- Using a Shunting-yard algorithm (;
+ Expressions are compiled and run by expr.c
  */
 
 #include "calculator.h"
+#include "editor.h"
+#include "expr.h"
+#include "history.h"
+#include "keymap.h"
 #include "lcd.h"
+#include "memory.h"
+#include "solve.h"
+#include "table.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_EXPR_LEN 64
-#define MAX_STACK 32
+// Significant digits shown for decimal results (0 = use %.3f)
+#ifndef CALC_BIG_DIGITS
+#define CALC_BIG_DIGITS 20
+#endif
+#if BIG_MAX_DIGITS == 0
+#undef CALC_BIG_DIGITS
+#define CALC_BIG_DIGITS 0
+#endif
+
+// Results of recent expressions, so # on one typed again skips the exact,
+// big decimal and float runs (0 = no cache)
+#ifndef CALC_CACHE_SIZE
+#define CALC_CACHE_SIZE 8
+#endif
+#define CALC_CACHE_TEXT 32 // Longer expressions are always run
 
 // State Management
-static char g_inputBuffer[MAX_EXPR_LEN];
-static int g_bufferIndex = 0;
 static int g_resetOnNextKey = 0;
 
-static int g_shiftActive = 0;  // 0=Off, 1=On
-static double g_lastAns = 0.0; // Store last result
+static int g_shiftActive = 0; // 0=Off, 1=Shift, 2=Cursor and memory keys
+static char g_memOp = 0;      // KEY_ACT_MPLUS/MMINUS/STORE wants 1-8
+
+// Expression line (row 1) scrolls horizontally over the editor buffer
+static int g_lineStart = 0; // First column after any "f(X)=" prompt
+static int g_lineEnd = 0;   // Columns drawn last time (stale cells to blank)
+static int g_scroll = 0;    // First token in the window
+static int g_errorTok = -1; // Token a syntax error points at, -1 = none
+
+// Variable values seen by compiled code (X, Ans = last result, M1-M8)
+static double g_vars[EXPR_NUM_VARS];
+static Rational g_ratVars[EXPR_NUM_VARS]; // Exact values, den 0 = none
+
+// Last Result
+static int g_hasResult = 0;    // Result on screen (S<>D can redraw it)
+static int g_resultExact = 0;  // g_ratResult holds the exact value
+static int g_showFraction = 0; // 0=Decimal, 1=Fraction
+static double g_result;
+static Rational g_ratResult;
+
+#if CALC_BIG_DIGITS > 0
+static BigDec g_bigVars[EXPR_NUM_VARS];
+static unsigned int g_bigValid = 0; // Bit n: g_bigVars[n] holds a value
+static int g_resultBig = 0;         // g_bigResult holds the result
+static BigDec g_bigResult;
+#endif
+
+static int g_mode = CALC_MODE_NORMAL;
+
+// Compiled form of the last evaluated expression
+static ExprProgram g_prog;
+
+#if CALC_CACHE_SIZE > 0
+typedef struct {
+  unsigned long hash; // Of the token text, 0 = empty slot
+  unsigned int varMask;
+  int len;
+  char text[CALC_CACHE_TEXT];
+  double result;
+  int exact;
+  Rational rat;
+#if CALC_BIG_DIGITS > 0
+  int big;
+  BigDec bigResult;
+#endif
+} CalcCacheEntry;
+
+static CalcCacheEntry g_cache[CALC_CACHE_SIZE];
+static int g_cacheNext = 0; // Slot replaced next (round robin)
+#endif
+static unsigned long g_cacheHits = 0;
+static unsigned long g_cacheMisses = 0;
 
-// Stacks for Evaluation
-static double valStack[MAX_STACK];
-static int valTop = -1;
-static char opStack[MAX_STACK];
-static int opTop = -1;
+// --- Helper Functions ---
+void Calc_Reset(void) {
+  Edit_Clear();
+  lcdClearScreen();
+  lcdClearScreen();
+
+  g_resetOnNextKey = 0;
+  g_hasResult = 0;
+  g_shiftActive = 0;
+  g_scroll = 0;
+  g_errorTok = -1;
 
-// Helper for isdigit (implementation)
-int my_isdigit(char c) { return (c >= '0' && c <= '9'); }
+  g_lineStart = 0;
+  if (g_mode == CALC_MODE_TABLE || g_mode == CALC_MODE_SOLVE) {
+    printDisplay("f(X)=");
+    g_lineStart = 5;
+  }
+  g_lineEnd = g_lineStart;
 
-int is_operator(char c) {
-  return (c == '+' || c == '-' || c == '*' || c == '/' || c == '^');
+  lcdCursorBlink(); // Ready for input
 }
 
-// 0 = OK, 1 = Error
-int ValidateSyntax(void) {
-  int i;
-  int lastIsOp = 0; // 0=No, 1=Yes
-  int lastIsDot = 0;
+// Display text for multi-character tokens, 0 for plain characters
+const char *Calc_TokenText(char c) {
+  switch (c) {
+  case EXPR_TOK_ANS:
+    return "Ans";
+  case EXPR_TOK_SQRT:
+    return "sqrt(";
+  case EXPR_TOK_SIN:
+    return "sin(";
+  case EXPR_TOK_COS:
+    return "cos(";
+  case EXPR_TOK_LN:
+    return "ln(";
+  case EXPR_TOK_EXP:
+    return "exp(";
+  default:
+    break;
+  }
 
-  if (g_bufferIndex == 0)
-    return 0; // Empty is safe (ignores #)
+  if ((unsigned char)(c - EXPR_TOK_MEM) < EXPR_NUM_MEM) {
+    static const char *const names[EXPR_NUM_MEM] = {"M1", "M2", "M3", "M4",
+                                                    "M5", "M6", "M7", "M8"};
+    return names[(unsigned char)(c - EXPR_TOK_MEM)];
+  }
+  return 0;
+}
 
-  // Check start
-  if (is_operator(g_inputBuffer[0]) && g_inputBuffer[0] != '-') {
-    return 1;
+// Number of LCD cells a buffer byte occupies
+int Calc_TokenWidth(char c) {
+  const char *text = Calc_TokenText(c);
+  return text ? (int)strlen(text) : 1;
+}
+
+// Show a syntax error with its 1-based position (-1 = over the limits)
+void Calc_ShowError(int errorPos) {
+  char posStr[24];
+  int col = 0;
+  int i;
+
+  if (errorPos < 0) {
+    g_errorTok = Edit_Length();
+    lcdClearScreen();
+    lcdCursorOff();
+    printDisplay("Too long");
+    g_resetOnNextKey = 1;
+    return;
   }
 
-  for (i = 0; i < g_bufferIndex; i++) {
-    char c = g_inputBuffer[i];
-
-    if (my_isdigit(c)) {
-      lastIsOp = 0;
-      lastIsDot = 0;
-    } else if (c == '.') {
-      if (lastIsDot)
-        return 1; // .. Error
-      lastIsDot = 1;
-      lastIsOp = 0;
-    } else if (is_operator(c)) {
-      if (lastIsOp)
-        return 1; // ** Error
-      lastIsOp = 1;
-      lastIsDot = 0;
-    } else {
+  // Cursor keys reopen the expression at the error
+  g_errorTok = errorPos < Edit_Length() ? errorPos : Edit_Length();
+
+  // Report the display column, not the buffer index
+  for (i = 0; i < errorPos && i < Edit_Length(); i++)
+    col += Calc_TokenWidth(Edit_At(i));
+  errorPos = col + (errorPos - i);
+
+  lcdClearScreen();
+  lcdCursorOff();
+  printDisplay("Syntax Error");
+  lcdSetCursor(1, 0); // Line 2
+  sprintf(posStr, "at position %d", errorPos + 1);
+  printDisplay(posStr);
+  g_resetOnNextKey = 1;
+}
+
+// Move the window so the cursor cell is on screen (1 = window moved)
+static int Calc_Scroll(void) {
+  int room = LCD_COLS - 1 - g_lineStart; // Last cell is left for the cursor
+  int cur = Edit_Cursor();
+  int len = Edit_Length();
+  int old = g_scroll;
+  int w = 0;
+  int i;
+
+  if (g_scroll > cur)
+    g_scroll = cur;
+  for (i = g_scroll; i < cur; i++)
+    w += Calc_TokenWidth(Edit_At(i));
+  while (w > room)
+    w -= Calc_TokenWidth(Edit_At(g_scroll++));
+
+  // Pull earlier tokens back in when the end of the text leaves space
+  for (i = cur; i < len && w <= room; i++)
+    w += Calc_TokenWidth(Edit_At(i));
+  while (g_scroll > 0 && w + Calc_TokenWidth(Edit_At(g_scroll - 1)) <= room)
+    w += Calc_TokenWidth(Edit_At(--g_scroll));
+
+  return g_scroll != old;
+}
+
+// Redraw the window from token 'from' to the right edge, then place the
+// cursor. Cells left of 'from' are already correct on screen.
+static void Calc_DrawLine(int from) {
+  int cur = Edit_Cursor();
+  int len = Edit_Length();
+  int col = g_lineStart;
+  int curCol = g_lineStart;
+  int end;
+  int i;
+
+  if (from < g_scroll)
+    from = g_scroll;
+  for (i = g_scroll; i < from && col < LCD_COLS; i++)
+    col += Calc_TokenWidth(Edit_At(i));
+  if (col > LCD_COLS)
+    col = LCD_COLS; // Past the edge: nothing to draw
+  for (i = g_scroll; i < cur; i++)
+    curCol += Calc_TokenWidth(Edit_At(i));
+
+  lcdSetCursor(0, (unsigned char)col);
+  for (i = from; i < len && col < LCD_COLS; i++) {
+    const char *text = Calc_TokenText(Edit_At(i));
+    if (!text) {
+      lcdWriteData(Edit_At(i));
+      col++;
+      continue;
+    }
+    while (*text && col < LCD_COLS) {
+      lcdWriteData(*text++); // Tokens past the edge are cut off
+      col++;
     }
   }
 
-  // Ends with operator. 5+ is error
-  if (lastIsOp)
-    return 1;
+  // Blank what the previous draw left behind
+  end = col;
+  while (col < g_lineEnd) {
+    lcdWriteData(' ');
+    col++;
+  }
+  g_lineEnd = end;
 
-  return 0;
+  lcdSetCursor(0, (unsigned char)curCol);
 }
 
-// --- Helper Functions ---
-void Calc_Reset(void) {
-  g_bufferIndex = 0;
-  memset(g_inputBuffer, 0, MAX_EXPR_LEN);
-  lcdClearScreen();
+// Redraw after an edit at token 'from' (whole window if it scrolled)
+static void Calc_Refresh(int from) {
+  if (Calc_Scroll())
+    from = g_scroll;
+  Calc_DrawLine(from);
+}
+
+// Print the visible part of the expression
+void Calc_PrintBuffer(void) {
+  g_lineEnd = g_lineStart;
+  Calc_DrawLine(g_scroll);
+}
+
+// Bring the expression back for editing after a result or error
+static void Calc_Reopen(void) {
   lcdClearScreen();
+  if (g_lineStart > 0)
+    printDisplay("f(X)=");
+  if (g_errorTok >= 0)
+    Edit_Seek(g_errorTok);
 
+  g_errorTok = -1;
+  g_hasResult = 0;
   g_resetOnNextKey = 0;
-  g_shiftActive = 0;
-  lcdCursorBlink(); // Ready for input
-}
 
-// Push value
-void pushVal(double v) {
-  if (valTop < MAX_STACK - 1)
-    valStack[++valTop] = v;
+  lcdCursorBlink();
+  Calc_Scroll();
+  Calc_PrintBuffer();
 }
 
-// Pop value
-double popVal(void) {
-  if (valTop >= 0)
-    return valStack[valTop--];
-  return 0.0;
-}
+// Print " = result" as a fraction or decimal
+void Calc_ShowResult(void) {
+  char outStr[48 + CALC_BIG_DIGITS];
+
+  if (g_resultExact && g_showFraction && g_ratResult.den != 1) {
+    sprintf(outStr, "= %lld/%lld", (long long)g_ratResult.num,
+            (long long)g_ratResult.den);
+#if CALC_BIG_DIGITS > 0
+  } else if (g_resultBig) {
+    outStr[0] = '=';
+    outStr[1] = ' ';
+    Big_Format(&g_bigResult, CALC_BIG_DIGITS, &outStr[2]);
+#endif
+  } else if (g_result == (long)g_result) {
+    // Check if integer
+    sprintf(outStr, "= %ld", (long)g_result);
+  } else {
+    sprintf(outStr, "= %.3f", g_result);
+  }
 
-// Push Op
-void pushOp(char op) {
-  if (opTop < MAX_STACK - 1)
-    opStack[++opTop] = op;
+  lcdCursorOff();       // Hide cursor while showing result
+  lcdWriteData(' ');    // Space before equals
+  printDisplay(outStr);
 }
 
-// Pop Op
-char popOp(void) {
-  if (opTop >= 0)
-    return opStack[opTop--];
-  return '\0';
-}
+#if CALC_BIG_DIGITS > 0
+// Big decimal value of an exact fraction (0 = OK, 1 = Error)
+static int Calc_RatToBig(Rational r, BigDec *out) {
+  char digits[24];
+  BigDec den;
+  unsigned long long mag = (r.num < 0) ? 0ULL - (unsigned long long)r.num
+                                       : (unsigned long long)r.num;
 
-// Get Precedence
-int precedence(char op) {
-  if (op == '+' || op == '-')
+  sprintf(digits, "%llu", mag);
+  if (Big_FromDigits(digits, (int)strlen(digits), out))
+    return 1;
+  sprintf(digits, "%llu", (unsigned long long)r.den);
+  if (Big_FromDigits(digits, (int)strlen(digits), &den) ||
+      Big_Div(out, &den, out))
     return 1;
-  if (op == '*' || op == '/')
-    return 2;
-  if (op == '^')
-    return 3; // Power has higher precedence
+  if (r.num < 0)
+    out->sign = (signed char)-out->sign;
   return 0;
 }
+#endif
 
-// Power Function
-double calc_pow(double base, double exp) {
-  double res = 1.0;
+// --- Result Cache ---
+#if CALC_CACHE_SIZE > 0
+// FNV-1a over the editor's tokens (never 0)
+static unsigned long Calc_Hash(const char *text, int len) {
+  unsigned long h = 2166136261UL;
   int i;
-  for (i = 0; i < (int)exp; i++)
-    res *= base;
-  return res;
+
+  for (i = 0; i < len; i++) {
+    h ^= (unsigned char)text[i];
+    h *= 16777619UL;
+  }
+  return h ? h : 1;
 }
 
-// Apply Operation
-double applyOp(double a, double b, char op) {
-  switch (op) {
-  case '+':
-    return a + b;
-  case '-':
-    return a - b;
-  case '*':
-    return a * b;
-  case '/':
-    return (b != 0) ? (a / b) : 0.0; // Avoid DivByZero crash
-  case '^':
-    return calc_pow(a, b);
-  default:
-    return 0.0;
+// Entry holding the result of 'text', or NULL
+static const CalcCacheEntry *Calc_CacheFind(const char *text, int len) {
+  unsigned long h;
+  int i;
+
+  if (len > CALC_CACHE_TEXT)
+    return 0;
+
+  h = Calc_Hash(text, len);
+  for (i = 0; i < CALC_CACHE_SIZE; i++) {
+    const CalcCacheEntry *e = &g_cache[i];
+    if (e->hash == h && e->len == len && memcmp(e->text, text, len) == 0) {
+      g_cacheHits++;
+      return e;
+    }
   }
+  g_cacheMisses++;
+  return 0;
 }
 
-// Evaluate the buffered string
-void Calc_Evaluate(void) {
-  if (ValidateSyntax()) {
-    lcdClearScreen();
-    printDisplay("Syntax Error");
-    g_resetOnNextKey = 1;
+// Keep the result just shown. An expression using Ans is not kept: its
+// result has just become the new Ans, so it is already out of date.
+static void Calc_CacheAdd(const char *text, int len, double result) {
+  CalcCacheEntry *e = &g_cache[g_cacheNext];
+
+  if (len > CALC_CACHE_TEXT || (g_prog.varMask & (1u << EXPR_VAR_ANS)))
     return;
-  }
 
+  e->hash = Calc_Hash(text, len);
+  e->varMask = g_prog.varMask;
+  e->len = len;
+  memcpy(e->text, text, len);
+  e->result = result;
+  e->exact = g_resultExact;
+  e->rat = g_ratResult;
+#if CALC_BIG_DIGITS > 0
+  e->big = g_resultBig;
+  e->bigResult = g_bigResult;
+#endif
+  g_cacheNext = (g_cacheNext + 1) % CALC_CACHE_SIZE;
+}
+#endif
+
+// Drop cached results that read any variable in 'varMask'
+static void Calc_CacheForget(unsigned int varMask) {
+#if CALC_CACHE_SIZE > 0
   int i;
 
-  valTop = -1;
-  opTop = -1;
+  for (i = 0; i < CALC_CACHE_SIZE; i++) {
+    if (g_cache[i].varMask & varMask)
+      g_cache[i].hash = 0;
+  }
+#else
+  (void)varMask;
+#endif
+}
 
-  // Simple Parser
-  for (i = 0; i < g_bufferIndex; i++) {
-    // Skip whitespace
-    if (g_inputBuffer[i] == ' ')
-      continue;
+void Calc_CacheStats(unsigned long *hits, unsigned long *misses) {
+  *hits = g_cacheHits;
+  *misses = g_cacheMisses;
+}
 
-    // If Digit or Decimal point, parse number
-    if (my_isdigit(g_inputBuffer[i]) || g_inputBuffer[i] == '.') {
-      char numStr[32];
-      int k = 0;
-      // Capture full number
-      while (i < g_bufferIndex &&
-             (my_isdigit(g_inputBuffer[i]) || g_inputBuffer[i] == '.')) {
+// Run g_prog, compiled from the editor's text
+static void Calc_Run(const char *text, int len) {
+  double result;
+#if CALC_CACHE_SIZE > 0
+  const CalcCacheEntry *hit;
+#endif
 
-        numStr[k++] = g_inputBuffer[i++];
-      }
-      numStr[k] = '\0';
-      i--; // Backtrack one step as loop increments
+  if (g_mode == CALC_MODE_TABLE) {
+    Table_Show(&g_prog, g_vars);
+    Calc_Reset(); // Back to f(X)= entry
+    return;
+  }
 
-      pushVal(atof(numStr));
-    } else {
-      // It's an operator
-      char currentOp = g_inputBuffer[i];
-
-      while (opTop != -1 &&
-             precedence(opStack[opTop]) >= precedence(currentOp)) {
-        double val2 = popVal();
-        double val1 = popVal();
-        char op = popOp();
-        pushVal(applyOp(val1, val2, op));
-      }
-      pushOp(currentOp);
+  if (g_mode == CALC_MODE_SOLVE) {
+    if (Solve_Show(&g_prog, g_vars, &result) == 0) {
+      g_vars[EXPR_VAR_ANS] = result; // Root is available as Ans
+      g_ratVars[EXPR_VAR_ANS].den = 0;
+#if CALC_BIG_DIGITS > 0
+      g_bigValid &= ~(1u << EXPR_VAR_ANS);
+#endif
     }
+    Calc_Reset();
+    return;
   }
 
-  // Apply remaining ops
-  while (opTop != -1) {
-    double val2 = popVal();
-    double val1 = popVal();
-    char op = popOp();
-    pushVal(applyOp(val1, val2, op));
+  // X only has a value in Table and Solve modes
+  if (g_prog.varMask & (1u << EXPR_VAR_X)) {
+    Calc_ShowError((int)(strchr(text, EXPR_TOK_X) - text));
+    return;
   }
 
-  // Result is at top of valStack
-  double result = popVal();
+#if CALC_CACHE_SIZE > 0
+  hit = Calc_CacheFind(text, len);
+  if (hit) {
+    result = hit->result;
+    g_resultExact = hit->exact;
+    g_ratResult = hit->rat;
+#if CALC_BIG_DIGITS > 0
+    g_resultBig = hit->big;
+    g_bigResult = hit->bigResult;
+#endif
+  } else
+#endif
+  {
+    // Exact first; overflow, long literals and functions fall back to float
+    g_resultExact = (Expr_RunRational(&g_prog, g_ratVars, &g_ratResult) == 0);
+
+#if CALC_BIG_DIGITS > 0
+    // Big decimal for the digits a double cannot hold. An exact result is
+    // converted, not recomputed: a decimal run may not land on it exactly.
+    Big_SetDigits(CALC_BIG_DIGITS);
+    if (g_resultExact)
+      g_resultBig = (Calc_RatToBig(g_ratResult, &g_bigResult) == 0);
+    else
+      g_resultBig = (Expr_RunBig(&g_prog, text, g_bigVars, g_bigValid,
+                                 &g_bigResult) == 0);
+#endif
+
+    if (g_resultExact)
+      result = Rat_ToDouble(g_ratResult);
+#if CALC_BIG_DIGITS > 0
+    else if (g_resultBig)
+      result = Big_ToDouble(&g_bigResult);
+#endif
+    else
+      result = Expr_Run(&g_prog, g_vars);
+  }
 
-  // Format Result String
+  // NaN or Inf (sqrt(-1), ln(0), overflow)
+  if (!(result - result == 0.0)) {
+    lcdClearScreen();
+    lcdCursorOff();
+    printDisplay("Math Error");
+    g_resetOnNextKey = 1;
+    return;
+  }
 
-  char outStr[32];
+  // Store Result in Ans
+  g_result = result;
+  g_vars[EXPR_VAR_ANS] = result;
+  g_ratVars[EXPR_VAR_ANS] = g_ratResult;
+  if (!g_resultExact)
+    g_ratVars[EXPR_VAR_ANS].den = 0;
+#if CALC_BIG_DIGITS > 0
+  g_bigVars[EXPR_VAR_ANS] = g_bigResult;
+  if (g_resultBig)
+    g_bigValid |= (1u << EXPR_VAR_ANS);
+  else
+    g_bigValid &= ~(1u << EXPR_VAR_ANS);
+#endif
+
+#if CALC_CACHE_SIZE > 0
+  if (!hit)
+    Calc_CacheAdd(text, len, result);
+#endif
+
+  History_Add(text, len, &g_prog, result);
+
+  Calc_Refresh(len);
+  Calc_ShowResult();
+
+  g_hasResult = 1;
+  g_resetOnNextKey = 1; // Flag to clear on next input
+}
 
-  // Check if integer
-  if (result == (long)result) {
-    sprintf(outStr, "= %ld", (long)result);
-  } else {
-    sprintf(outStr, "= %.3f", result);
+// Evaluate the buffered string
+void Calc_Evaluate(void) {
+  const char *text;
+  int len;
+  int errorPos;
+
+  if (Edit_Length() == 0) {
+    if (g_mode == CALC_MODE_SOLVE) {
+      Solve_Benchmark(); // # on empty f(X) runs the built-in set
+      Calc_Reset();
+    }
+    return; // Empty is safe (ignores #)
   }
 
-  // Store Result in Ans
-  g_lastAns = result;
+  len = Edit_Length();
+  text = Edit_Text(); // Cursor goes to the end, where the result follows
+  if (Expr_Compile(text, len, &g_prog, &errorPos)) {
+    Calc_ShowError(errorPos);
+    return;
+  }
 
-  lcdCursorOff();       // Hide cursor while showing result
-  lcdWriteData(' ');    // Space before equals
-  printDisplay(outStr);
+  Calc_Run(text, len);
+}
 
-  g_resetOnNextKey = 1; // Flag to clear on next input
+// Show a message on line 4, leaving the cursor where it was
+static void Calc_ShowStatus(const char *msg) {
+  lcdWriteRow(3, msg); // Line 4
+  if (!g_resetOnNextKey)
+    Calc_DrawLine(Edit_Length()); // Back to the editor cursor
 }
 
-// --- Public Interface ---
-void Calc_Init(void) { Calc_Reset(); }
+// M+, M- or Store (KEY_ACT_*) Ans into register 'reg' (0 = M1)
+static void Calc_MemoryOp(char op, int reg) {
+  int v = EXPR_VAR_MEM + reg;
+  double ans = g_vars[EXPR_VAR_ANS];
+  Rational exact = g_ratVars[EXPR_VAR_ANS];
+  char line[32];
 
-int Calc_IsShiftActive(void) { return g_shiftActive; }
+  if (op == KEY_ACT_STORE) {
+    g_vars[v] = ans;
+  } else {
+    g_vars[v] = (op == KEY_ACT_MPLUS) ? g_vars[v] + ans : g_vars[v] - ans;
+    if (g_ratVars[v].den == 0 || exact.den == 0 ||
+        (op == KEY_ACT_MPLUS ? Rat_Add(g_ratVars[v], exact, &exact)
+                             : Rat_Sub(g_ratVars[v], exact, &exact)))
+      exact.den = 0; // Only the float value is kept
+  }
+  g_ratVars[v] = exact;
+
+#if CALC_BIG_DIGITS > 0
+  {
+    const BigDec *bigAns = &g_bigVars[EXPR_VAR_ANS];
+    int ok = (g_bigValid & (1u << EXPR_VAR_ANS)) != 0;
+
+    if (op == KEY_ACT_STORE)
+      g_bigVars[v] = *bigAns;
+    else if (ok && (g_bigValid & (1u << v)))
+      ok = !(op == KEY_ACT_MPLUS
+                 ? Big_Add(&g_bigVars[v], bigAns, &g_bigVars[v])
+                 : Big_Sub(&g_bigVars[v], bigAns, &g_bigVars[v]));
+    else
+      ok = 0;
+
+    if (ok)
+      g_bigValid |= (1u << v);
+    else
+      g_bigValid &= ~(1u << v);
+  }
+#endif
 
-void Calc_ProcessKey(char key) {
+  Calc_CacheForget(1u << v);
+  Mem_Save(&g_vars[EXPR_VAR_MEM], &g_ratVars[EXPR_VAR_MEM], reg);
 
-  if (g_resetOnNextKey) {
-    if (key == '#')
-      return; // Ignore repeated equals
-    Calc_Reset();
-  }
+  if (g_vars[v] == (long)g_vars[v])
+    sprintf(line, "M%d = %ld", reg + 1, (long)g_vars[v]);
+  else
+    sprintf(line, "M%d = %.10g", reg + 1, g_vars[v]);
+  Calc_ShowStatus(line);
+}
 
-  // Input Key Handling
-  if (key == '#') {
-    // Evaluate
-    Calc_Evaluate();
+// Pick a history entry, then run it (already compiled) or edit it
+static void Calc_History(void) {
+  static char src[HIST_MAX_SRC + 1];
+  int action = History_Show(src, &g_prog);
+  int i;
+
+  Calc_Reset();
+  if (action == HIST_EXIT)
     return;
-  }
 
-  // Handle Backspace ('*')
-  if (key == '*') {
-    if (g_bufferIndex > 0) {
-      g_bufferIndex--;
-      g_inputBuffer[g_bufferIndex] = '\0';
-      lcdBackspace();
+  for (i = 0; src[i]; i++)
+    Edit_Insert(src[i]);
+  Calc_Refresh(0);
+
+  if (action == HIST_RUN)
+    Calc_Run(Edit_Text(), Edit_Length());
+}
+
+// --- Public Interface ---
+void Calc_Init(void) {
+  g_ratVars[EXPR_VAR_X].den = 0; // X is never exact
+  g_ratVars[EXPR_VAR_ANS].num = 0;
+  g_ratVars[EXPR_VAR_ANS].den = 1;
+  // Registers keep their float and exact values across power cycles
+  Mem_Init(&g_vars[EXPR_VAR_MEM], &g_ratVars[EXPR_VAR_MEM]);
+#if CALC_BIG_DIGITS > 0
+  Big_SetDigits(CALC_BIG_DIGITS);
+  Big_FromInt(0, &g_bigVars[EXPR_VAR_ANS]);
+  g_bigValid = (1u << EXPR_VAR_ANS);
+  {
+    int v;
+    for (v = EXPR_VAR_MEM; v < EXPR_NUM_VARS; v++) {
+      if (g_ratVars[v].den != 0 &&
+          Calc_RatToBig(g_ratVars[v], &g_bigVars[v]) == 0)
+        g_bigValid |= (1u << v);
     }
-    return;
   }
+#endif
+  History_Init();
+  Calc_Reset();
+}
 
-  // Map Keypad Chars to Operators
-  char displayChar = key;
-  char bufferChar = key;
+int Calc_IsShiftActive(void) { return g_shiftActive == 1; }
 
+void Calc_SetMode(int mode) { g_mode = mode; }
 
-  // Reset defaults for this key
-  displayChar = key;
-  bufferChar = key;
+// Cursor layer actions that move the cursor
+static int Calc_IsCursorKey(char key) {
+  return key >= KEY_ACT_LEFT && key <= KEY_ACT_END;
+}
 
-  // Handle Shift Key Toggle ('D')
+// M+, M- and Store in the cursor layer
+static int Calc_IsMemoryKey(char key) {
+  return key >= KEY_ACT_MPLUS && key <= KEY_ACT_STORE;
+}
 
-  if (key == 'D') {
-    g_shiftActive = !g_shiftActive;
-    // Toggle Shift
-    return;
+int Calc_ProcessKey(unsigned char code) {
+  char key = Key_Map(KEY_LAYER_CALC + g_shiftActive, code);
+
+  // Keys without a cursor layer meaning act as usual
+  if (g_shiftActive == 2 && key == KEY_NONE)
+    key = Key_Map(KEY_LAYER_CALC, code);
+
+  // Register number after M+, M- or Store (anything else cancels)
+  if (g_memOp) {
+    char op = g_memOp;
+    char reg = Key_Map(KEY_LAYER_LEGEND, code);
+    g_memOp = 0;
+    g_shiftActive = 0;
+    if (reg >= '1' && reg <= '8')
+      Calc_MemoryOp(op, reg - '1');
+    else
+      Calc_ShowStatus("");
+    return 0;
+  }
+
+  // Backspace with nothing left to delete goes back to the menu
+  if (key == KEY_ACT_BACK && Edit_Length() == 0 && !g_resetOnNextKey) {
+    g_shiftActive = 0;
+    return 1;
   }
 
-  if (g_shiftActive) {
-    // SHIFT MAPPINGS
-    switch (key) {
-    case '0':
-      bufferChar = '.';
-      displayChar = '.';
-      break; // Shift+0 = Dot
-
-    case 'A':
-      // Shift+A = Ans
-      {
-        char ansStr[32];
-        int len;
-        if (g_lastAns == (long)g_lastAns)
-          sprintf(ansStr, "%ld", (long)g_lastAns);
-        else
-          sprintf(ansStr, "%.3f", g_lastAns);
-
-        len = strlen(ansStr);
-
-        // Allow if buffer fits
-        if (g_bufferIndex + len < MAX_EXPR_LEN) {
-          strcpy(&g_inputBuffer[g_bufferIndex], ansStr);
-          g_bufferIndex += len;
-          printDisplay("Ans");
-          g_shiftActive = 0; // Auto-untoggle
-          return;
-        }
-        g_shiftActive = 0; // Auto-untoggle even if full
-        return;
-      }
-
-    case 'B':
-      bufferChar = '^';
-      displayChar = '^';
-      break; // Shift+B = Power
-
-    case 'C':
-      bufferChar = '/';
-      displayChar = '/';
-      break; // Shift+C = Divide
-    default:
-      break;
+  if (g_resetOnNextKey) {
+    int shift = g_shiftActive;
+    if (key == KEY_ACT_EVAL)
+      return 0; // Ignore repeated equals
+    if (key == KEY_ACT_SHIFT || key == KEY_ACT_FRACTION ||
+        Calc_IsMemoryKey(key)) {
+      // Shift, S<>D and memory keys act on the result without clearing it
+    } else if (Calc_IsCursorKey(key)) {
+      Calc_Reopen(); // Edit the expression instead of starting over
+      return 0;
+    } else {
+      Calc_Reset();
+      g_shiftActive = shift;
     }
+  }
 
+  // Shift Key ('D'): Off -> Shift -> Cursor keys -> Off
+  if (key == KEY_ACT_SHIFT) {
+    g_shiftActive = (g_shiftActive + 1) % 3;
+    return 0;
+  }
 
+  // Cursor keys stay active until any other key is pressed
+  if (g_shiftActive == 2) {
+    if (Calc_IsMemoryKey(key)) {
+      g_memOp = key;
+      if (key == KEY_ACT_MPLUS)
+        Calc_ShowStatus("M+ Ans to M1-8?");
+      else if (key == KEY_ACT_MMINUS)
+        Calc_ShowStatus("M- Ans from M1-8?");
+      else
+        Calc_ShowStatus("Store Ans in M1-8?");
+      return 0;
+    }
+    if (Calc_IsCursorKey(key)) {
+      if (key == KEY_ACT_LEFT)
+        Edit_Left();
+      else if (key == KEY_ACT_RIGHT)
+        Edit_Right();
+      else if (key == KEY_ACT_HOME)
+        Edit_Seek(0);
+      else
+        Edit_Seek(Edit_Length());
+      Calc_Refresh(Edit_Length()); // Redraws only if the window moved
+      return 0;
+    }
+  }
 
+  // Shift applies to one key only
+  g_shiftActive = 0;
 
-    // Auto-untoggle Shift
-    g_shiftActive = 0;
+  switch (key) {
+  case KEY_NONE:
+  case KEY_ACT_PIN: // Handled by main
+    return 0;
 
+  case KEY_ACT_EVAL:
+    Calc_Evaluate();
+    return 0;
 
-  } else {
+  case KEY_ACT_HISTORY:
+    Calc_History();
+    return 0;
 
-    // NORMAL MAPPINGS
-    switch (key) {
-    case 'A':
-      bufferChar = '+';
-      displayChar = '+';
-      break;
-    case 'B':
-      bufferChar = '-';
-      displayChar = '-';
-      break;
-    case 'C':
-      bufferChar = '*';
-      displayChar = '*';
-      break;
-    default:
-      break;
-    }
+  case KEY_ACT_BACK: {
+    int cur = Edit_Cursor();
+    if (Edit_Delete() == 0)
+      Calc_Refresh(cur - 1); // Token before the cursor
+    return 0;
   }
 
+  case KEY_ACT_FRACTION:
+    // S<>D (fraction/decimal result)
+    g_showFraction = !g_showFraction;
+    if (g_hasResult && g_resetOnNextKey) {
+      lcdClearScreen();
+      Calc_PrintBuffer();
+      Calc_ShowResult();
+    }
+    return 0;
 
+  default:
+    break;
+  }
+
+  {
+    int cur = Edit_Cursor();
 
-  if (g_bufferIndex < MAX_EXPR_LEN - 1) {
-    g_inputBuffer[g_bufferIndex++] = bufferChar;
-    g_inputBuffer[g_bufferIndex] = '\0';
+    // Ans followed by 1-8 recalls M1-M8 (a digit after Ans is never valid)
+    if (key >= '1' && key <= '8' && cur > 0 &&
+        Edit_At(cur - 1) == EXPR_TOK_ANS) {
+      Edit_Delete();
+      cur--;
+      key = (char)(EXPR_TOK_MEM + (key - '1'));
+    }
 
-    lcdWriteData(displayChar);
+    if (Edit_Insert(key) == 0)
+      Calc_Refresh(cur); // Typing at the end only draws the new token
   }
+  return 0;
 }
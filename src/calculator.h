@@ -5,14 +5,29 @@
 #ifndef CALCULATOR_H
 #define CALCULATOR_H
 
+// Calculator Modes (what # does with the expression)
+#define CALC_MODE_NORMAL 0 // Evaluate and show result
+#define CALC_MODE_TABLE 1  // Tabulate f(X)
+#define CALC_MODE_SOLVE 2  // Solve f(X) = 0
+
 // Initialize Calculator (Same as Reset)
 void Calc_Init(void);
 void Calc_Reset(void);
 
-// Process Key Input
-void Calc_ProcessKey(char key);
+// Process a raw key code from readKeypad.
+// Returns 1 when the key leaves the calculator (* on an empty line), else 0
+int Calc_ProcessKey(unsigned char code);
 
 // Check if Shift is Active
 int Calc_IsShiftActive(void);
 
+// Select Mode (takes effect on next Calc_Reset)
+void Calc_SetMode(int mode);
+
+// Display text for multi-character tokens, 0 for plain characters
+const char *Calc_TokenText(char c);
+
+// Result cache lookups on # that were answered / had to run
+void Calc_CacheStats(unsigned long *hits, unsigned long *misses);
+
 #endif /* CALCULATOR_H_ */
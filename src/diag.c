@@ -0,0 +1,210 @@
+/*
+ * File: diag.c
+ * Description: Diagnostics screen. Lines are formatted when drawn, so the
+ *              screen needs no buffer of its own.
+ */
+
+#include "diag.h"
+
+#include "SysTick.h"
+#include "calculator.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "power.h"
+#include "stack.h"
+#include "trace.h"
+
+#include <stdio.h>
+
+#define DIAG_VISIBLE 3 // Line 1 is the key help
+#define DIAG_SYSTEM_LINES 4
+#define DIAG_SUMMARY_LINES 8
+#define DIAG_NUM_LINES                                                         \
+  (DIAG_SYSTEM_LINES + DIAG_SUMMARY_LINES + TRACE_NUM_KEYS)
+
+// Legends in key number order (row * 4 + column)
+static const char g_legends[TRACE_NUM_KEYS + 1] = "123A456B789C*0#D";
+
+// Format line n of the results into buf (LCD_COLS + 1 chars)
+static void Diag_Line(int n, char *buf) {
+  const TraceResult *r = Trace_Result();
+  const TraceResult *b = Trace_Baseline();
+  const TraceSoak *soak = Trace_SoakResult();
+  const TraceKey *k;
+  unsigned long rate;
+  unsigned long hits, misses;
+  unsigned long long run, wait, lcd, all;
+  int flags;
+
+  buf[0] = '\0';
+
+  if (n == 0) {
+    snprintf(buf, LCD_COLS + 1, "Stack %lu/%luB", Stack_HighWater(),
+             Stack_Size());
+    return;
+  }
+  if (n == 1) {
+    snprintf(buf, LCD_COLS + 1, "Free %luB RAM %luB",
+             Stack_Size() - Stack_HighWater(), Stack_StaticRam());
+    return;
+  }
+  if (n == 2) {
+    Calc_CacheStats(&hits, &misses);
+    snprintf(buf, LCD_COLS + 1, "Cache %lu hit %lu miss", hits, misses);
+    return;
+  }
+  if (n == 3) {
+    // Where the time went since reset
+    run = Power_Cycles(POWER_RUN);
+    wait = Power_Cycles(POWER_WAIT);
+    lcd = Power_Cycles(POWER_LCD);
+    all = run + wait + lcd + 1;
+    snprintf(buf, LCD_COLS + 1, "Run%lu Wait%lu LCD%lu%%",
+             (unsigned long)(run * 100 / all),
+             (unsigned long)(wait * 100 / all),
+             (unsigned long)(lcd * 100 / all));
+    return;
+  }
+  n -= DIAG_SYSTEM_LINES;
+
+  switch (n) {
+  case 0:
+    snprintf(buf, LCD_COLS + 1, "Trace: %d keys", Trace_Edges() / 2);
+    return;
+  case 1:
+    if (r)
+      snprintf(buf, LCD_COLS + 1, "p50 %lu p95 %lums", r->p50Ms, r->p95Ms);
+    else
+      snprintf(buf, LCD_COLS + 1, "No run yet");
+    return;
+  case 2:
+    if (r)
+      snprintf(buf, LCD_COLS + 1, "Max %lums Drop %lu", r->maxMs, r->dropped);
+    return;
+  case 3:
+    if (r)
+      snprintf(buf, LCD_COLS + 1, "Session %lu.%lus", r->sessionMs / 1000,
+               (r->sessionMs % 1000) / 100);
+    return;
+  case 4:
+    if (r)
+      snprintf(buf, LCD_COLS + 1, "%lu.%02lumC/key idle%lumA",
+               r->keyUc / 1000, (r->keyUc % 1000) / 10, r->idleUa / 1000);
+    return;
+  case 5:
+    if (!b) {
+      snprintf(buf, LCD_COLS + 1, "No baseline");
+      return;
+    }
+    flags = Trace_Regressions();
+    snprintf(buf, LCD_COLS + 1, "Base %lums %s", b->p95Ms,
+             (flags & 1)   ? "SLOWER"
+             : (flags & 2) ? "DROPS"
+             : (flags & 4) ? "LONGER"
+             : (flags & 8) ? "ENERGY"
+             : r           ? "OK"
+                           : "");
+    return;
+  case 6:
+    if (soak)
+      snprintf(buf, LCD_COLS + 1, "4:Soak %d/%d bad %d", soak->runs,
+               TRACE_SOAK_RUNS, soak->bad);
+    else
+      snprintf(buf, LCD_COLS + 1, "4:Soak not run");
+    return;
+  case 7:
+    if (soak && soak->ms > 0) {
+      rate = soak->edges * 5000UL / soak->ms; // Presses per 10 s
+      snprintf(buf, LCD_COLS + 1, "%lu.%lukey/s drop %lu", rate / 10,
+               rate % 10, soak->dropped);
+    }
+    return;
+  }
+
+  n -= DIAG_SUMMARY_LINES;
+  k = Trace_KeyStats(n);
+  if (k && k->count > 0)
+    snprintf(buf, LCD_COLS + 1, "%c n%-3u av%-4lu mx%u", g_legends[n],
+             k->count, k->sumMs / k->count, k->maxMs);
+  else
+    snprintf(buf, LCD_COLS + 1, "%c -", g_legends[n]);
+}
+
+static void Diag_Draw(int first) {
+  char buf[LCD_COLS + 1];
+  int r;
+
+  lcdWriteRow(0, "1:Rec 2:Play 3:Base");
+  for (r = 0; r < DIAG_VISIBLE; r++) {
+    Diag_Line(first + r, buf);
+    lcdWriteRow(r + 1, buf);
+  }
+}
+
+// Show a message on a cleared screen for a moment
+static void Diag_Message(char *line1, char *line2) {
+  lcdClearScreen();
+  printDisplay(line1);
+  lcdSetCursor(1, 0);
+  printDisplay(line2);
+  SysTick_Wait10ms(150);
+}
+
+int Diag_Show(void) {
+  int first = 0;
+
+  Trace_Stop();
+  if (Trace_SoakNext() == 0)
+    return 1; // Soak continues with the next run
+
+  lcdClearScreen();
+  lcdCursorOff();
+  Diag_Draw(first);
+
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(KEY_LAYER_PAGER, k);
+
+      // Commands are the menu digits
+      if (c == KEY_NONE)
+        c = Key_Map(KEY_LAYER_MENU, k);
+
+      // Wait for release
+      while (readKeypad() != 0)
+        ;
+
+      if (c == KEY_ACT_EXIT)
+        return 0;
+      if (c == '1') {
+        Diag_Message("Recording...", "Menu 9 stops");
+        Trace_Record();
+        return 1;
+      }
+      if (c == '2') {
+        if (Trace_Replay() == 0) {
+          Diag_Message("Replaying...", "Any key stops");
+          return 1;
+        }
+        Diag_Message("No trace", "Record one first");
+      }
+      if (c == '4') {
+        if (Trace_Soak() == 0) {
+          Diag_Message("Soak test...", "Any key stops");
+          return 1;
+        }
+        Diag_Message("No trace", "Record one first");
+      }
+      if (c == '3')
+        Diag_Message(Trace_SaveBaseline() ? "No results" : "Baseline saved",
+                     "");
+      if (c == KEY_ACT_NEXT && first + DIAG_VISIBLE < DIAG_NUM_LINES)
+        first++;
+      if (c == KEY_ACT_PREV && first > 0)
+        first--;
+      Diag_Draw(first);
+    }
+    SysTick_Wait10ms(5);
+  }
+}
@@ -0,0 +1,18 @@
+/*
+ * File: diag.h
+ * Description: Public interface for the diagnostics screen.
+ */
+
+#ifndef DIAG_H
+#define DIAG_H
+
+// Shows stack use, cache counters, time per power state and key trace
+// results, 3 lines at a time below the key help.
+// Entering it ends any recording or replay, and starts the next run of a
+// soak test without showing anything.
+// Keys: 1:Record 2:Replay 3:Save baseline 4:Soak #:Down *:Up 0:Exit
+// Returns 1 if a recording, replay or soak run was started (the caller
+// locks the device so the run starts from the PIN screen), 0 otherwise
+int Diag_Show(void);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * File: editor.c
+ * Description: Gap buffer for the expression editor.
+ *
+ *   [ before cursor | ...gap... | after cursor ]
+ *   0           gapStart     gapEnd     EDIT_CAPACITY
+ */
+
+#include "editor.h"
+
+static char g_buf[EDIT_CAPACITY];
+static int g_gapStart = 0; // Cursor (tokens before it live at 0..gapStart-1)
+static int g_gapEnd = EDIT_CAPACITY; // First token after the cursor
+
+void Edit_Clear(void) {
+  g_gapStart = 0;
+  g_gapEnd = EDIT_CAPACITY;
+}
+
+int Edit_Insert(char c) {
+  // Keep one free byte so Edit_Text can terminate the string
+  if (g_gapEnd - g_gapStart <= 1)
+    return 1;
+  g_buf[g_gapStart++] = c;
+  return 0;
+}
+
+int Edit_Delete(void) {
+  if (g_gapStart == 0)
+    return 1;
+  g_gapStart--;
+  return 0;
+}
+
+int Edit_Left(void) {
+  if (g_gapStart == 0)
+    return 1;
+  g_buf[--g_gapEnd] = g_buf[--g_gapStart];
+  return 0;
+}
+
+int Edit_Right(void) {
+  if (g_gapEnd == EDIT_CAPACITY)
+    return 1;
+  g_buf[g_gapStart++] = g_buf[g_gapEnd++];
+  return 0;
+}
+
+void Edit_Seek(int pos) {
+  while (g_gapStart > pos && Edit_Left() == 0)
+    ;
+  while (g_gapStart < pos && Edit_Right() == 0)
+    ;
+}
+
+int Edit_Length(void) { return EDIT_CAPACITY - (g_gapEnd - g_gapStart); }
+
+int Edit_Cursor(void) { return g_gapStart; }
+
+char Edit_At(int i) {
+  if (i >= g_gapStart)
+    i += g_gapEnd - g_gapStart;
+  return g_buf[i];
+}
+
+const char *Edit_Text(void) {
+  Edit_Seek(Edit_Length());
+  g_buf[g_gapStart] = '\0';
+  return g_buf;
+}
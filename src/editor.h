@@ -0,0 +1,45 @@
+/*
+ * File: editor.h
+ * Description: Gap buffer holding the expression being typed.
+ *              Insert and delete at the cursor are O(1); moving the
+ *              cursor moves the gap.
+ */
+
+#ifndef EDITOR_H
+#define EDITOR_H
+
+// Buffer size in bytes (one byte per token, one kept free for the gap)
+#ifndef EDIT_CAPACITY
+#define EDIT_CAPACITY 256
+#endif
+
+// Empty the buffer
+void Edit_Clear(void);
+
+// Insert a token before the cursor (0 = OK, 1 = Full)
+int Edit_Insert(char c);
+
+// Delete the token before the cursor (0 = OK, 1 = Nothing to delete)
+int Edit_Delete(void);
+
+// Move the cursor one token (0 = OK, 1 = Already at the end)
+int Edit_Left(void);
+int Edit_Right(void);
+
+// Move the cursor to a token index (clamped to 0..Edit_Length())
+void Edit_Seek(int pos);
+
+// Number of tokens
+int Edit_Length(void);
+
+// Token index of the cursor
+int Edit_Cursor(void);
+
+// Token at an index (0 <= i < Edit_Length())
+char Edit_At(int i);
+
+// Close the gap and return the tokens as one NUL-terminated string.
+// The cursor moves to the end.
+const char *Edit_Text(void);
+
+#endif /* EDITOR_H_ */
@@ -0,0 +1,668 @@
+/*
+ * File: expr.c
+ * Description: Expression compiler and evaluator.
+ *              Single pass operator-precedence parser emitting postfix code,
+ *              plus a scalar and a batch (column-at-a-time) interpreter.
+ */
+
+#include "expr.h"
+#include "sci.h"
+
+// Compiler operator stack
+static char opStack[EXPR_MAX_OPS];
+static int opTop = -1;
+
+// Interpreter stacks. Only one interpreter runs at a time, so they share
+// the RAM.
+static union {
+  double val[EXPR_MAX_STACK];
+  Rational rat[EXPR_MAX_STACK];
+#if BIG_MAX_DIGITS > 0
+  BigDec big[EXPR_MAX_STACK];
+#endif
+  double batch[EXPR_MAX_STACK][EXPR_BATCH];
+} stacks;
+
+// Helper for isdigit (implementation)
+static int my_isdigit(char c) { return (c >= '0' && c <= '9'); }
+
+// Variable index of a token, -1 if it is not a variable
+static int var_index(char c) {
+  unsigned char m = (unsigned char)(c - EXPR_TOK_MEM);
+  if (c == EXPR_TOK_X)
+    return EXPR_VAR_X;
+  if (c == EXPR_TOK_ANS)
+    return EXPR_VAR_ANS;
+  if (m < EXPR_NUM_MEM)
+    return EXPR_VAR_MEM + m;
+  return -1;
+}
+
+static int is_operator(char c) {
+  return (c == '+' || c == '-' || c == '*' || c == '/' || c == '^');
+}
+
+// Get Precedence
+// 'n' is unary minus: binds tighter than * and /, looser than ^ (-2^2 = -4)
+static int precedence(char op) {
+  if (op == '+' || op == '-')
+    return 1;
+  if (op == '*' || op == '/')
+    return 2;
+  if (op == EXPR_OP_NEG)
+    return 3;
+  if (op == '^')
+    return 4; // Power has higher precedence
+  return 0;   // '(' and functions never reduce
+}
+
+// Power is right-associative: 2^3^2 = 2^(3^2)
+static int is_right_assoc(char op) { return (op == '^' || op == EXPR_OP_NEG); }
+
+// Map a function token to its opcode, 0 if not a function
+static char function_op(char c) {
+  switch (c) {
+  case EXPR_TOK_SQRT:
+    return EXPR_OP_SQRT;
+  case EXPR_TOK_SIN:
+    return EXPR_OP_SIN;
+  case EXPR_TOK_COS:
+    return EXPR_OP_COS;
+  case EXPR_TOK_LN:
+    return EXPR_OP_LN;
+  case EXPR_TOK_EXP:
+    return EXPR_OP_EXP;
+  default:
+    return 0;
+  }
+}
+
+static int is_function(char op) {
+  return (op == EXPR_OP_SQRT || op == EXPR_OP_SIN || op == EXPR_OP_COS ||
+          op == EXPR_OP_LN || op == EXPR_OP_EXP);
+}
+
+// Apply a unary operation (minus or function)
+static double applyUnary(double a, char op) {
+  switch (op) {
+  case EXPR_OP_NEG:
+    return -a;
+  case EXPR_OP_SQRT:
+    return Sci_Sqrt((float)a);
+  case EXPR_OP_SIN:
+    return Sci_Sin((float)a);
+  case EXPR_OP_COS:
+    return Sci_Cos((float)a);
+  case EXPR_OP_LN:
+    return Sci_Ln((float)a);
+  case EXPR_OP_EXP:
+    return Sci_Exp((float)a);
+  default:
+    return 0.0;
+  }
+}
+
+// Power Function
+// Integer exponents square and multiply; others use exp(b*ln(a)) for
+// a >= 0. A negative base needs an integer exponent.
+#define EXPR_POW_EVEN 9007199254740992.0 // 2^53: every double past it is even
+
+static double calc_pow(double base, double exp) {
+  double res = 1.0;
+  double mag = (exp < 0) ? -exp : exp;
+  unsigned long long n;
+
+  if (mag != mag)
+    return exp; // NaN
+  if (mag >= EXPR_POW_EVEN) {
+    if (base < 0)
+      base = -base;
+    return Sci_Exp((float)(exp * Sci_Ln((float)base)));
+  }
+
+  n = (unsigned long long)mag; // In range: checked above
+  if ((double)n != mag) {
+    if (base < 0)
+      return Sci_NaN(); // (-8)^0.5
+    return Sci_Exp((float)(exp * Sci_Ln((float)base)));
+  }
+
+  while (n > 0) {
+    if (n & 1)
+      res *= base;
+    n >>= 1;
+    if (n > 0)
+      base *= base;
+  }
+  return (exp < 0) ? ((res != 0) ? (1.0 / res) : 0.0) : res;
+}
+
+// Apply Operation
+static double applyOp(double a, double b, char op) {
+  switch (op) {
+  case '+':
+    return a + b;
+  case '-':
+    return a - b;
+  case '*':
+    return a * b;
+  case '/':
+    return (b != 0) ? (a / b) : 0.0; // Avoid DivByZero crash
+  case '^':
+    return calc_pow(a, b);
+  default:
+    return 0.0;
+  }
+}
+
+// --- Compiler ---
+
+// Append one byte of code. Returns 0 on success, 1 if full
+static int emit(ExprProgram *prog, unsigned char b) {
+  if (prog->codeLen >= EXPR_MAX_CODE)
+    return 1;
+  prog->code[prog->codeLen++] = b;
+  return 0;
+}
+
+// Pop the top operator into the code stream
+static int emitTop(ExprProgram *prog, int *depth) {
+  char op = opStack[opTop--];
+  if (op != EXPR_OP_NEG && !is_function(op))
+    (*depth)--; // Binary: two operands in, one out
+  return emit(prog, (unsigned char)op);
+}
+
+// Track operand stack depth so Expr_Run can never overflow
+static int pushDepth(int *depth) {
+  if (*depth >= EXPR_MAX_STACK)
+    return 1;
+  (*depth)++;
+  return 0;
+}
+
+// Parse the number at src[*pos] into a new constant and emit it.
+// Returns 0 on success, 1 on error (errorPos = offending index, -1 = full)
+static int scanNumber(const char *src, int len, int *pos, ExprProgram *prog,
+                      int *depth, int *errorPos) {
+  // Parse number in place: mantissa first, then scale once
+  double mant = 0.0;
+  double scale = 1.0;
+  int i = *pos;
+  int start = i;
+  int64_t exactMant = 0;
+  int exactScale = 0;
+  int numDigits = 0;
+  int seenDot = 0;
+  int seenDigit = 0;
+
+  while (i < len) {
+    char c = src[i];
+    if (my_isdigit(c)) {
+      mant = mant * 10.0 + (c - '0');
+      if (seenDot)
+        scale *= 10.0;
+      if (numDigits < EXPR_MAX_DIGITS) {
+        exactMant = exactMant * 10 + (c - '0');
+        if (seenDot)
+          exactScale++;
+      }
+      if (exactMant != 0 || seenDot)
+        numDigits++; // Leading zeros are free
+      seenDigit = 1;
+    } else if (c == '.') {
+      if (seenDot) {
+        *errorPos = i; // 1.2.3
+        return 1;
+      }
+      seenDot = 1;
+    } else {
+      break;
+    }
+    i++;
+  }
+
+  if (!seenDigit) {
+    *errorPos = i - 1; // Lone '.'
+    return 1;
+  }
+  if (prog->numConsts >= EXPR_MAX_CONSTS || pushDepth(depth) ||
+      emit(prog, EXPR_OP_CONST) ||
+      emit(prog, (unsigned char)prog->numConsts)) {
+    *errorPos = -1;
+    return 1;
+  }
+  prog->consts[prog->numConsts] = mant / scale;
+  prog->constMant[prog->numConsts] = exactMant;
+  prog->constScale[prog->numConsts] =
+      (numDigits <= EXPR_MAX_DIGITS) ? (signed char)exactScale : -1;
+  prog->constPos[prog->numConsts] = (unsigned short)start;
+  prog->constLen[prog->numConsts] = (unsigned short)(i - start);
+  prog->numConsts++;
+  *pos = i;
+  return 0;
+}
+
+// Emit a variable operand
+static int emitVar(ExprProgram *prog, char tok, int *depth) {
+  unsigned char var = (unsigned char)var_index(tok);
+  if (pushDepth(depth) || emit(prog, EXPR_OP_VAR) || emit(prog, var))
+    return 1;
+  prog->varMask |= (1u << var);
+  return 0;
+}
+
+int Expr_Compile(const char *src, int len, ExprProgram *prog, int *errorPos) {
+  int i = 0;
+  int expectOperand = 1; // 1 = number, '(' or unary minus may follow
+  int depth = 0;
+
+  opTop = -1;
+  prog->codeLen = 0;
+  prog->numConsts = 0;
+  prog->varMask = 0;
+
+  while (i < len) {
+    char c = src[i];
+
+    if (expectOperand) {
+      if (my_isdigit(c) || c == '.') {
+        if (scanNumber(src, len, &i, prog, &depth, errorPos))
+          return 1;
+        expectOperand = 0;
+        continue;
+      } else if (var_index(c) >= 0) {
+        if (emitVar(prog, c, &depth)) {
+          *errorPos = -1;
+          return 1;
+        }
+        expectOperand = 0;
+      } else if (function_op(c)) {
+        // Function token: the op waits under its own '('
+        if (opTop >= EXPR_MAX_OPS - 2) {
+          *errorPos = -1;
+          return 1;
+        }
+        opStack[++opTop] = function_op(c);
+        opStack[++opTop] = '(';
+      } else if (c == '(' || c == '-') {
+        // Prefix operators never reduce anything
+        if (opTop >= EXPR_MAX_OPS - 1) {
+          *errorPos = -1;
+          return 1;
+        }
+        opStack[++opTop] = (c == '-') ? EXPR_OP_NEG : '(';
+      } else {
+        *errorPos = i; // Operator or ')' where a number belongs
+        return 1;
+      }
+    } else {
+      if (c == ')') {
+        while (opTop != -1 && opStack[opTop] != '(') {
+          if (emitTop(prog, &depth)) {
+            *errorPos = -1;
+            return 1;
+          }
+        }
+        if (opTop == -1) {
+          *errorPos = i; // Unmatched ')'
+          return 1;
+        }
+        opTop--; // Discard '('
+
+        // Closing a function call applies the function
+        if (opTop != -1 && is_function(opStack[opTop]) &&
+            emitTop(prog, &depth)) {
+          *errorPos = -1;
+          return 1;
+        }
+      } else if (is_operator(c)) {
+        int p = precedence(c);
+        while (opTop != -1 && (precedence(opStack[opTop]) > p ||
+                               (precedence(opStack[opTop]) == p &&
+                                !is_right_assoc(c)))) {
+          if (emitTop(prog, &depth)) {
+            *errorPos = -1;
+            return 1;
+          }
+        }
+        if (opTop >= EXPR_MAX_OPS - 1) {
+          *errorPos = -1;
+          return 1;
+        }
+        opStack[++opTop] = c;
+        expectOperand = 1;
+      } else {
+        *errorPos = i; // Number or '(' directly after a value
+        return 1;
+      }
+    }
+    i++;
+  }
+
+  // Ends with operator. 5+ is error
+  if (expectOperand) {
+    *errorPos = len;
+    return 1;
+  }
+
+  // Flush remaining ops
+  while (opTop != -1) {
+    if (opStack[opTop] == '(') {
+      *errorPos = len; // Unclosed '('
+      return 1;
+    }
+    if (emitTop(prog, &depth)) {
+      *errorPos = -1;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int Expr_Ops(const ExprProgram *prog, char *ops) {
+  int n = 0;
+  int pc = 0;
+
+  while (pc < prog->codeLen) {
+    unsigned char op = prog->code[pc++];
+    if (op == EXPR_OP_CONST || op == EXPR_OP_VAR) {
+      pc++; // Index follows from source order
+      op = EXPR_OP_OPERAND;
+    }
+    ops[n++] = (char)op;
+  }
+  return n;
+}
+
+int Expr_Load(const char *src, int len, const char *ops, int numOps,
+              ExprProgram *prog) {
+  int i = 0;
+  int depth = 0;
+  int errorPos;
+  int k;
+
+  prog->codeLen = 0;
+  prog->numConsts = 0;
+  prog->varMask = 0;
+
+  for (k = 0; k < numOps; k++) {
+    char op = ops[k];
+
+    if (op == EXPR_OP_OPERAND) {
+      // Operands appear in the code in the same order as in the source
+      while (i < len && !my_isdigit(src[i]) && src[i] != '.' &&
+             var_index(src[i]) < 0)
+        i++;
+      if (i == len)
+        return 1;
+      if (var_index(src[i]) >= 0) {
+        if (emitVar(prog, src[i++], &depth))
+          return 1;
+      } else if (scanNumber(src, len, &i, prog, &depth, &errorPos)) {
+        return 1;
+      }
+    } else if (op == EXPR_OP_NEG || is_function(op)) {
+      if (depth < 1 || emit(prog, (unsigned char)op))
+        return 1;
+    } else if (is_operator(op)) {
+      if (depth < 2 || emit(prog, (unsigned char)op))
+        return 1;
+      depth--;
+    } else {
+      return 1;
+    }
+  }
+
+  return (depth == 1) ? 0 : 1;
+}
+
+// --- Interpreters ---
+
+double Expr_Run(const ExprProgram *prog, const double *vars) {
+  int pc = 0;
+  int top = -1;
+
+  while (pc < prog->codeLen) {
+    unsigned char op = prog->code[pc++];
+    switch (op) {
+    case EXPR_OP_CONST:
+      stacks.val[++top] = prog->consts[prog->code[pc++]];
+      break;
+    case EXPR_OP_VAR:
+      stacks.val[++top] = vars[prog->code[pc++]];
+      break;
+    case EXPR_OP_NEG:
+      stacks.val[top] = -stacks.val[top];
+      break;
+    case EXPR_OP_SQRT:
+    case EXPR_OP_SIN:
+    case EXPR_OP_COS:
+    case EXPR_OP_LN:
+    case EXPR_OP_EXP:
+      stacks.val[top] = applyUnary(stacks.val[top], op);
+      break;
+    default:
+      stacks.val[top - 1] = applyOp(stacks.val[top - 1], stacks.val[top], op);
+      top--;
+      break;
+    }
+  }
+
+  return stacks.val[0];
+}
+
+// Runs each opcode across a whole block of X values before moving to the
+// next, so dispatch is paid once per block and the inner loops are plain
+// array arithmetic the compiler can vectorize.
+void Expr_RunBatch(const ExprProgram *prog, const double *vars,
+                   const double *xs, double *out, int n) {
+  int base;
+
+  for (base = 0; base < n; base += EXPR_BATCH) {
+    int m = n - base;
+    int pc = 0;
+    int top = -1;
+    int j;
+
+    if (m > EXPR_BATCH)
+      m = EXPR_BATCH;
+
+    while (pc < prog->codeLen) {
+      unsigned char op = prog->code[pc++];
+      double *a;
+      double *b;
+
+      switch (op) {
+      case EXPR_OP_CONST: {
+        double k = prog->consts[prog->code[pc++]];
+        a = stacks.batch[++top];
+        for (j = 0; j < m; j++)
+          a[j] = k;
+        break;
+      }
+      case EXPR_OP_VAR: {
+        unsigned char idx = prog->code[pc++];
+        a = stacks.batch[++top];
+        if (idx == EXPR_VAR_X) {
+          for (j = 0; j < m; j++)
+            a[j] = xs[base + j];
+        } else {
+          for (j = 0; j < m; j++)
+            a[j] = vars[idx];
+        }
+        break;
+      }
+      case EXPR_OP_NEG:
+        a = stacks.batch[top];
+        for (j = 0; j < m; j++)
+          a[j] = -a[j];
+        break;
+      case EXPR_OP_SQRT:
+      case EXPR_OP_SIN:
+      case EXPR_OP_COS:
+      case EXPR_OP_LN:
+      case EXPR_OP_EXP:
+        a = stacks.batch[top];
+        for (j = 0; j < m; j++)
+          a[j] = applyUnary(a[j], op);
+        break;
+      case '+':
+        a = stacks.batch[top - 1];
+        b = stacks.batch[top--];
+        for (j = 0; j < m; j++)
+          a[j] = a[j] + b[j];
+        break;
+      case '-':
+        a = stacks.batch[top - 1];
+        b = stacks.batch[top--];
+        for (j = 0; j < m; j++)
+          a[j] = a[j] - b[j];
+        break;
+      case '*':
+        a = stacks.batch[top - 1];
+        b = stacks.batch[top--];
+        for (j = 0; j < m; j++)
+          a[j] = a[j] * b[j];
+        break;
+      case '/':
+        a = stacks.batch[top - 1];
+        b = stacks.batch[top--];
+        for (j = 0; j < m; j++)
+          a[j] = (b[j] != 0) ? (a[j] / b[j]) : 0.0;
+        break;
+      default:
+        a = stacks.batch[top - 1];
+        b = stacks.batch[top--];
+        for (j = 0; j < m; j++)
+          a[j] = applyOp(a[j], b[j], op);
+        break;
+      }
+    }
+
+    for (j = 0; j < m; j++)
+      out[base + j] = stacks.batch[0][j];
+  }
+}
+
+int Expr_RunRational(const ExprProgram *prog, const Rational *vars,
+                     Rational *out) {
+  int pc = 0;
+  int top = -1;
+
+  while (pc < prog->codeLen) {
+    unsigned char op = prog->code[pc++];
+    Rational *a;
+    int err = 0;
+
+    switch (op) {
+    case EXPR_OP_CONST: {
+      unsigned char k = prog->code[pc++];
+      int64_t den = 1;
+      int s;
+      if (prog->constScale[k] < 0)
+        return 1;
+      for (s = 0; s < prog->constScale[k]; s++)
+        den *= 10;
+      err = Rat_Make(prog->constMant[k], den, &stacks.rat[++top]);
+      break;
+    }
+    case EXPR_OP_VAR:
+      stacks.rat[++top] = vars[prog->code[pc++]];
+      err = (stacks.rat[top].den == 0);
+      break;
+    case EXPR_OP_NEG:
+      a = &stacks.rat[top];
+      err = (a->num == INT64_MIN); // -INT64_MIN does not fit
+      if (!err)
+        a->num = -a->num;
+      break;
+    case '+':
+    case '-':
+    case '*':
+    case '/':
+    case '^':
+      a = &stacks.rat[top - 1];
+      if (op == '+')
+        err = Rat_Add(*a, stacks.rat[top], a);
+      else if (op == '-')
+        err = Rat_Sub(*a, stacks.rat[top], a);
+      else if (op == '*')
+        err = Rat_Mul(*a, stacks.rat[top], a);
+      else if (op == '/')
+        err = Rat_Div(*a, stacks.rat[top], a);
+      else
+        err = Rat_Pow(*a, stacks.rat[top], a);
+      top--;
+      break;
+    default:
+      return 1; // Functions have no exact form
+    }
+
+    if (err)
+      return 1;
+  }
+
+  *out = stacks.rat[0];
+  return 0;
+}
+
+#if BIG_MAX_DIGITS > 0
+int Expr_RunBig(const ExprProgram *prog, const char *src, const BigDec *vars,
+                unsigned int varValid, BigDec *out) {
+  int pc = 0;
+  int top = -1;
+
+  while (pc < prog->codeLen) {
+    unsigned char op = prog->code[pc++];
+    BigDec *a;
+    int err = 0;
+
+    switch (op) {
+    case EXPR_OP_CONST: {
+      unsigned char k = prog->code[pc++];
+      err = Big_FromDigits(&src[prog->constPos[k]], prog->constLen[k],
+                           &stacks.big[++top]);
+      break;
+    }
+    case EXPR_OP_VAR: {
+      unsigned char v = prog->code[pc++];
+      if (!(varValid & (1u << v)))
+        return 1;
+      stacks.big[++top] = vars[v];
+      break;
+    }
+    case EXPR_OP_NEG:
+      stacks.big[top].sign = (signed char)-stacks.big[top].sign;
+      break;
+    case '+':
+    case '-':
+    case '*':
+    case '/':
+    case '^':
+      a = &stacks.big[top - 1];
+      if (op == '+')
+        err = Big_Add(a, &stacks.big[top], a);
+      else if (op == '-')
+        err = Big_Sub(a, &stacks.big[top], a);
+      else if (op == '*')
+        err = Big_Mul(a, &stacks.big[top], a);
+      else if (op == '/')
+        err = Big_Div(a, &stacks.big[top], a);
+      else
+        err = Big_Pow(a, &stacks.big[top], a);
+      top--;
+      break;
+    default:
+      return 1; // Functions are single precision only
+    }
+
+    if (err)
+      return 1;
+  }
+
+  *out = stacks.big[0];
+  return 0;
+}
+#endif
@@ -0,0 +1,116 @@
+/*
+ * File: expr.h
+ * Description: Public interface for the expression compiler and evaluator.
+ *              An expression is compiled once into postfix code, then run
+ *              for any number of variable values without re-parsing.
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "bignum.h"
+#include "editor.h"
+#include "rational.h"
+
+#include <stdint.h>
+
+// Limits cover any expression that fits the editor (EDIT_CAPACITY - 1
+// tokens). A one-digit literal or a variable compiles to 2 bytes and
+// needs an operator after it; every other token compiles to at most 1.
+#define EXPR_MAX_CODE (2 * EDIT_CAPACITY)
+#define EXPR_MAX_CONSTS (EDIT_CAPACITY / 2 + 1)
+#define EXPR_MAX_STACK (EDIT_CAPACITY / 2 + 1) // Operands
+#define EXPR_MAX_OPS (2 * EDIT_CAPACITY) // Pending operators, "sqrt(" takes 2
+#define EXPR_MAX_DIGITS 18 // Literal digits kept exactly (fits int64)
+
+#if EXPR_MAX_CONSTS > 256
+#error "Constant indices are one byte of code"
+#endif
+
+// X values per pass of the batch kernel.
+// Host builds can raise this (e.g. -DEXPR_BATCH=64) so the per-opcode
+// loops vectorize with SSE/AVX.
+#ifndef EXPR_BATCH
+#define EXPR_BATCH 4
+#endif
+
+// Buffer Tokens (one byte each)
+#define EXPR_TOK_X 'X'
+#define EXPR_TOK_ANS '\x80' // Displays as "Ans"
+#define EXPR_TOK_SQRT '\x81' // Function tokens include the '('
+#define EXPR_TOK_SIN '\x82'
+#define EXPR_TOK_COS '\x83'
+#define EXPR_TOK_LN '\x84'
+#define EXPR_TOK_EXP '\x85'
+#define EXPR_TOK_MEM '\x90' // M1-M8 are '\x90'-'\x97'
+
+// Opcodes (binary operators use their own character)
+#define EXPR_OP_CONST 'k' // Followed by constant index
+#define EXPR_OP_VAR 'v'   // Followed by variable index
+#define EXPR_OP_NEG 'n'   // Unary minus
+#define EXPR_OP_SQRT 'q'  // Functions (unary, single precision)
+#define EXPR_OP_SIN 's'
+#define EXPR_OP_COS 'c'
+#define EXPR_OP_LN 'l'
+#define EXPR_OP_EXP 'e'
+#define EXPR_OP_OPERAND 'o' // Expr_Ops only: next operand in source order
+
+// Variables
+#define EXPR_VAR_X 0
+#define EXPR_VAR_ANS 1
+#define EXPR_VAR_MEM 2 // M1-M8 are variables 2-9
+#define EXPR_NUM_MEM 8
+#define EXPR_NUM_VARS (EXPR_VAR_MEM + EXPR_NUM_MEM)
+
+typedef struct {
+  unsigned char code[EXPR_MAX_CODE];
+  int codeLen;
+  double consts[EXPR_MAX_CONSTS];
+  int64_t constMant[EXPR_MAX_CONSTS];       // Exact literal = mant / 10^scale
+  signed char constScale[EXPR_MAX_CONSTS];  // -1 if the literal is too long
+  unsigned short constPos[EXPR_MAX_CONSTS]; // Literal text in the source
+  unsigned short constLen[EXPR_MAX_CONSTS];
+  int numConsts;
+  unsigned int varMask; // Bit n set if variable n is referenced
+} ExprProgram;
+
+// Compile 'len' chars of 'src' in a single pass.
+// Returns 0 on success, 1 on error (errorPos = offending index, or -1 if
+// the expression is longer than the limits above)
+int Expr_Compile(const char *src, int len, ExprProgram *prog, int *errorPos);
+
+// Operator list of compiled code: constants and variables become
+// EXPR_OP_OPERAND, everything else is copied. ops needs codeLen bytes.
+// Returns the number of ops
+int Expr_Ops(const ExprProgram *prog, char *ops);
+
+// Rebuild a program from its source and the list from Expr_Ops without
+// running the parser. Returns 0 on success, 1 if they do not match
+int Expr_Load(const char *src, int len, const char *ops, int numOps,
+              ExprProgram *prog);
+
+// Run compiled code. vars[] holds EXPR_NUM_VARS values.
+double Expr_Run(const ExprProgram *prog, const double *vars);
+
+// Run compiled code for n values of X: out[i] = f(xs[i])
+void Expr_RunBatch(const ExprProgram *prog, const double *vars,
+                   const double *xs, double *out, int n);
+
+// Run compiled code in exact rational arithmetic.
+// A variable with den == 0 has no exact value.
+// Returns 0 if exact, 1 if a function, long literal, overflow or
+// division by zero needs the floating point result instead
+int Expr_RunRational(const ExprProgram *prog, const Rational *vars,
+                     Rational *out);
+
+#if BIG_MAX_DIGITS > 0
+// Run compiled code in big decimal at the current Big_SetDigits precision.
+// Literals are re-read from src at full length. Bit n of varValid says
+// vars[n] holds a value.
+// Returns 0 on success, 1 if a function, missing variable or overflow
+// needs the floating point result instead
+int Expr_RunBig(const ExprProgram *prog, const char *src, const BigDec *vars,
+                unsigned int varValid, BigDec *out);
+#endif
+
+#endif /* EXPR_H_ */
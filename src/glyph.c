@@ -0,0 +1,81 @@
+/*
+ * File: glyph.c
+ * Description: CGRAM glyph cache with LRU eviction.
+ */
+
+#include "glyph.h"
+
+#include "lcd.h"
+
+#define GLYPH_SLOTS 8
+#define GLYPH_NONE 0xFF
+
+typedef struct {
+  unsigned char rows[8]; // 5 pixels per row, bit 4 = left
+  char fallback;         // Shown when no slot can be freed
+} Glyph;
+
+static const Glyph g_library[GLYPH_COUNT] = {
+    {{0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00}, '#'}, // Lock
+    {{0x0E, 0x01, 0x01, 0x1F, 0x1B, 0x1B, 0x1F, 0x00}, '#'}, // Unlock
+    {{0x07, 0x04, 0x04, 0x04, 0x14, 0x0C, 0x04, 0x00}, 'v'}, // Square root
+    {{0x00, 0x00, 0x1F, 0x0A, 0x0A, 0x0A, 0x13, 0x00}, 'p'}, // Pi
+    {{0x0C, 0x12, 0x04, 0x08, 0x1E, 0x00, 0x00, 0x00}, '2'}, // Squared
+    {{0x09, 0x1B, 0x09, 0x09, 0x09, 0x00, 0x00, 0x00}, 'i'}, // Inverse
+    {{0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00}, '^'}, // Up
+    {{0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00}, 'v'}, // Down
+    {{0x00, 0x04, 0x08, 0x1F, 0x08, 0x04, 0x00, 0x00}, '<'}, // Left
+    {{0x00, 0x04, 0x02, 0x1F, 0x02, 0x04, 0x00, 0x00}, '>'}, // Right
+    {{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10}, ' '}, // Bar 1/5
+    {{0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18}, ' '}, // Bar 2/5
+    {{0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C}, ' '}, // Bar 3/5
+    {{0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E}, ' '}, // Bar 4/5
+};
+
+// Slot State
+static unsigned char g_slotGlyph[GLYPH_SLOTS]; // Resident glyph or NONE
+static unsigned long g_slotUsed[GLYPH_SLOTS];  // Last use, for LRU
+static unsigned long g_clock = 0;
+
+void Glyph_Init(void) {
+  int s;
+  for (s = 0; s < GLYPH_SLOTS; s++) {
+    g_slotGlyph[s] = GLYPH_NONE;
+    g_slotUsed[s] = 0;
+  }
+}
+
+char Glyph_Use(int id) {
+  int victim = -1;
+  int s;
+
+  if (id < 0 || id >= GLYPH_COUNT)
+    return ' ';
+  g_clock++;
+
+  for (s = 0; s < GLYPH_SLOTS; s++) {
+    if (g_slotGlyph[s] == id) {
+      g_slotUsed[s] = g_clock; // Hit: nothing to send
+      return (char)(8 + s);
+    }
+  }
+
+  // Miss: free slots first, then the least recently used one that is
+  // not visible (rewriting a visible slot would change the screen)
+  for (s = 0; s < GLYPH_SLOTS; s++) {
+    if (g_slotGlyph[s] == GLYPH_NONE) {
+      victim = s;
+      break;
+    }
+    if (!lcdShowsSlot(s) &&
+        (victim < 0 || g_slotUsed[s] < g_slotUsed[victim]))
+      victim = s;
+  }
+  if (victim < 0)
+    return g_library[id].fallback;
+
+  lcdCreateCustomChar((unsigned char)victim, g_library[id].rows);
+  g_slotGlyph[victim] = (unsigned char)id;
+  g_slotUsed[victim] = g_clock;
+  return (char)(8 + victim);
+}
@@ -0,0 +1,36 @@
+/*
+ * File: glyph.h
+ * Description: Custom character manager. A library of 5x8 glyphs is
+ *              mapped onto the 8 CGRAM slots on demand, evicting the
+ *              least recently used glyph that is not on screen.
+ */
+
+#ifndef GLYPH_H
+#define GLYPH_H
+
+// Library symbols
+#define GLYPH_LOCK 0
+#define GLYPH_UNLOCK 1
+#define GLYPH_SQRT 2
+#define GLYPH_PI 3
+#define GLYPH_SQUARED 4 // Superscript 2
+#define GLYPH_INVERSE 5 // Superscript -1
+#define GLYPH_UP 6
+#define GLYPH_DOWN 7
+#define GLYPH_LEFT 8
+#define GLYPH_RIGHT 9
+#define GLYPH_BAR1 10 // Progress cell, 1 of 5 columns filled
+#define GLYPH_BAR2 11
+#define GLYPH_BAR3 12
+#define GLYPH_BAR4 13 // 5 of 5 is the built-in block 0xFF
+#define GLYPH_COUNT 14
+
+// Forget all slots (call after lcdInit; CGRAM content is then unknown)
+void Glyph_Init(void);
+
+// Character code that shows glyph 'id', uploading it if it is not
+// resident. Codes are 8-15, so they can be used inside strings. If every
+// slot is on screen, returns the glyph's ASCII fallback instead.
+char Glyph_Use(int id);
+
+#endif
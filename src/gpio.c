@@ -0,0 +1,37 @@
+/*
+ * File: gpio.c
+ * Description: GPIO port setup and pin timing.
+ */
+
+#include "gpio.h"
+
+#include "perf.h"
+
+// System Control
+#define SYSCTL_GPIOHBCTL 0x400FE06C // Bit n: port n on AHB
+#define SYSCTL_RCGCGPIO 0x400FE608
+#define SYSCTL_PRGPIO_R (*((volatile unsigned long *)0x400FEA08))
+
+#define GPIO_NUM_PORTS 6
+
+void Gpio_Init(unsigned long ports) {
+  int p;
+
+  for (p = 0; p < GPIO_NUM_PORTS; p++) {
+    if (ports & (1UL << p)) {
+      GPIO_BITBAND(SYSCTL_RCGCGPIO, p) = 1;
+      GPIO_BITBAND(SYSCTL_GPIOHBCTL, p) = 1;
+    }
+  }
+
+  // Wait until the ports are ready
+  while ((SYSCTL_PRGPIO_R & ports) != ports)
+    ;
+}
+
+void Gpio_Hold(unsigned long cycles) {
+  unsigned long start = Perf_Cycles();
+
+  while (Perf_Cycles() - start < cycles)
+    ;
+}
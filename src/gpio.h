@@ -0,0 +1,45 @@
+/*
+ * File: gpio.h
+ * Description: Public interface for GPIO port setup and pin timing.
+ *              The LCD and keypad ports are moved from the legacy APB
+ *              aperture (0x40004000...) to the AHB one (0x40058000...),
+ *              which takes a store in one cycle instead of two or more.
+ *              Once a port is on AHB its APB addresses no longer work.
+ */
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include "perf.h"
+
+// Ports, for Gpio_Init
+#define GPIO_PORT_A 0x01
+#define GPIO_PORT_B 0x02
+#define GPIO_PORT_D 0x08
+#define GPIO_PORT_E 0x10
+
+// AHB base addresses
+#define GPIO_PORTA_AHB_BASE 0x40058000
+#define GPIO_PORTB_AHB_BASE 0x40059000
+#define GPIO_PORTD_AHB_BASE 0x4005B000
+#define GPIO_PORTE_AHB_BASE 0x4005C000
+
+// Bit-band alias of one bit of a peripheral register: a store there sets
+// or clears just that bit, with no read-modify-write in software. GPIO
+// data pins are faster still through their masked address (the pins to
+// touch in address bits 9:2), which is what the drivers use.
+#define GPIO_BITBAND(addr, bit)                                                \
+  (*((volatile unsigned long *)(0x42000000UL + (((addr)-0x40000000UL) << 5) + \
+                                ((bit) << 2))))
+
+// Cycles to cover ns at 80 MHz, rounded up
+#define GPIO_NS(ns) (((ns) * PERF_CYCLES_PER_US + 999) / 1000)
+
+// Clock the ports and put them on AHB (after Perf_Init)
+void Gpio_Init(unsigned long ports);
+
+// Wait at least 'cycles' CPU cycles, timed by the DWT counter, so the
+// minimum holds whatever the bus and compiler do around it
+void Gpio_Hold(unsigned long cycles);
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * File: history.c
+ * Description: Calculation history.
+ *
+ * Entries sit oldest first in a RAM ring. New entries are also appended
+ * to a log in flash using the same layout, so the log can be replayed on
+ * start-up and rewritten from RAM when it fills. Entry layout, padded to
+ * a 4-byte boundary:
+ *
+ *   [src nibbles][op nibbles][nibbles, high first ...][result (double)]
+ *
+ * Digits, '.', and + - * / take one source nibble; any other token
+ * takes an escape nibble plus its byte. Each postfix op takes one nibble.
+ */
+
+#include "history.h"
+
+#include "SysTick.h"
+#include "calculator.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define HIST_MAGIC 0x54534948 // "HIST"
+#define HIST_ESC 0xF          // Source nibble: raw token byte follows
+
+// Largest entry in words (HIST_MAX_SRC source nibbles, full code)
+#define HIST_ENTRY_BYTES (2 + (HIST_MAX_SRC + EXPR_MAX_CODE + 1) / 2 + 8)
+#define HIST_ENTRY_WORDS ((HIST_ENTRY_BYTES + 3) / 4)
+
+static const char g_srcCodes[] = "0123456789.+-*/"; // Nibbles 0x0-0xE
+static const char g_opCodes[] = "o+-*/^nqscle";
+
+static uint32_t g_ring[HIST_BYTES / 4];
+static int g_used = 0; // Bytes in the ring
+static int g_count = 0;
+static uint32_t g_flashNext = 0; // Next free byte of the log, 0 = unformatted
+
+static uint32_t g_entry[HIST_ENTRY_WORDS]; // Entry being packed or loaded
+
+// Nibble index of a character in a code table, -1 if absent
+static int History_Code(const char *table, char c) {
+  int i;
+  for (i = 0; table[i]; i++) {
+    if (table[i] == c)
+      return i;
+  }
+  return -1;
+}
+
+static int History_Nibble(const unsigned char *e, int i) {
+  unsigned char b = e[2 + i / 2];
+  return (i & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+static void History_Put(unsigned char *e, int i, int v) {
+  unsigned char *b = &e[2 + i / 2];
+  if (i & 1)
+    *b = (unsigned char)(*b | v);
+  else
+    *b = (unsigned char)(v << 4);
+}
+
+// Bytes taken by an entry, padding included
+static int History_Size(const unsigned char *e) {
+  return (2 + (e[0] + e[1] + 1) / 2 + 8 + 3) & ~3;
+}
+
+// Copy an entry into the ring, dropping the oldest until it fits
+static void History_Append(const unsigned char *e) {
+  unsigned char *ring = (unsigned char *)g_ring;
+  int size = History_Size(e);
+
+  while (g_count > 0 && g_used + size > HIST_BYTES) {
+    int first = History_Size(ring);
+    memmove(ring, ring + first, (size_t)(g_used - first));
+    g_used -= first;
+    g_count--;
+  }
+
+  memcpy(ring + g_used, e, (size_t)size);
+  g_used += size;
+  g_count++;
+}
+
+// Append the newest entry to the flash log; when the page is full,
+// erase it once and write the ring back in one go
+static void History_Flash(const unsigned char *e) {
+  int size = History_Size(e);
+  int i;
+
+  if (g_flashNext == 0 || g_flashNext + size > FLASH_HISTORY_SIZE) {
+    for (i = 0; i < FLASH_HISTORY_SIZE; i += FLASH_PAGE_SIZE)
+      Flash_Erase(FLASH_HISTORY_ADDR + i);
+    Flash_Write(FLASH_HISTORY_ADDR, HIST_MAGIC);
+    for (i = 0; i < g_used; i += 4)
+      Flash_Write(FLASH_HISTORY_ADDR + 4 + i, g_ring[i / 4]);
+    g_flashNext = 4 + g_used;
+    return;
+  }
+
+  for (i = 0; i < size; i += 4)
+    Flash_Write(FLASH_HISTORY_ADDR + g_flashNext + i, g_entry[i / 4]);
+  g_flashNext += size;
+}
+
+void History_Init(void) {
+  uint32_t end = FLASH_HISTORY_ADDR + FLASH_HISTORY_SIZE;
+  uint32_t addr = FLASH_HISTORY_ADDR + 4;
+  unsigned char *e = (unsigned char *)g_entry;
+
+  g_used = 0;
+  g_count = 0;
+  g_flashNext = 0;
+
+  if (Flash_Read(FLASH_HISTORY_ADDR) != HIST_MAGIC)
+    return; // Blank page: formatted on the first add
+
+  // Replay the log; an erased word (0xFF..) ends it
+  while (addr < end) {
+    int size;
+    int i;
+
+    g_entry[0] = Flash_Read(addr);
+    if (e[0] == 0 || e[0] > HIST_MAX_SRC || e[1] == 0)
+      break;
+    size = History_Size(e);
+    if (addr + size > end)
+      break;
+    for (i = 4; i < size; i += 4)
+      g_entry[i / 4] = Flash_Read(addr + i);
+    History_Append(e);
+    addr += size;
+  }
+  g_flashNext = addr - FLASH_HISTORY_ADDR;
+}
+
+int History_Add(const char *src, int len, const ExprProgram *prog,
+                double result) {
+  static char ops[EXPR_MAX_CODE];
+  unsigned char *e = (unsigned char *)g_entry;
+  int numOps = Expr_Ops(prog, ops);
+  int nSrc = 0;
+  int n = 0;
+  int i;
+
+  for (i = 0; i < len; i++)
+    nSrc += (History_Code(g_srcCodes, src[i]) >= 0) ? 1 : 3;
+  if (nSrc == 0 || nSrc > HIST_MAX_SRC || numOps == 0)
+    return 1;
+
+  e[0] = (unsigned char)nSrc;
+  e[1] = (unsigned char)numOps;
+  memset(e + 2, 0, (size_t)(History_Size(e) - 2));
+
+  for (i = 0; i < len; i++) {
+    int code = History_Code(g_srcCodes, src[i]);
+    if (code >= 0) {
+      History_Put(e, n++, code);
+    } else {
+      History_Put(e, n++, HIST_ESC);
+      History_Put(e, n++, (unsigned char)src[i] >> 4);
+      History_Put(e, n++, src[i] & 0x0F);
+    }
+  }
+  for (i = 0; i < numOps; i++)
+    History_Put(e, n++, History_Code(g_opCodes, ops[i]));
+  memcpy(&e[2 + (n + 1) / 2], &result, sizeof(result));
+
+  History_Append(e);
+  History_Flash(e);
+  return 0;
+}
+
+int History_Count(void) { return g_count; }
+
+int History_Get(int n, char *src, ExprProgram *prog, double *result) {
+  static char ops[EXPR_MAX_CODE];
+  const unsigned char *e = (const unsigned char *)g_ring;
+  int len = 0;
+  int i;
+
+  if (n < 0 || n >= g_count)
+    return -1;
+  for (i = g_count - 1; i > n; i--)
+    e += History_Size(e); // Oldest first
+
+  i = 0;
+  while (i < e[0]) {
+    int v = History_Nibble(e, i++);
+    if (v == HIST_ESC) {
+      src[len++] =
+          (char)((History_Nibble(e, i) << 4) | History_Nibble(e, i + 1));
+      i += 2;
+    } else {
+      src[len++] = g_srcCodes[v];
+    }
+  }
+  src[len] = '\0';
+
+  for (i = 0; i < e[1]; i++) {
+    int v = History_Nibble(e, e[0] + i);
+    if (v >= (int)sizeof(g_opCodes) - 1 || i >= EXPR_MAX_CODE)
+      return -1;
+    ops[i] = g_opCodes[v];
+  }
+  memcpy(result, &e[2 + (e[0] + e[1] + 1) / 2], sizeof(*result));
+
+  if (Expr_Load(src, len, ops, e[1], prog))
+    return -1;
+  return len;
+}
+
+// Entry number, expression (cut at the edge) and stored result
+static void History_Draw(int n, const char *src, double result) {
+  char line[32];
+  int col = 0;
+  int i;
+
+  lcdClearScreen();
+  sprintf(line, "History %d/%d", n + 1, g_count);
+  printDisplay(line);
+
+  lcdSetCursor(1, 0); // Line 2
+  for (i = 0; src[i] && col < LCD_COLS; i++) {
+    const char *text = Calc_TokenText(src[i]);
+    if (!text) {
+      lcdWriteData(src[i]);
+      col++;
+      continue;
+    }
+    while (*text && col < LCD_COLS) {
+      lcdWriteData(*text++);
+      col++;
+    }
+  }
+
+  lcdSetCursor(2, 0); // Line 3
+  if (result == (long)result)
+    sprintf(line, "= %ld", (long)result);
+  else
+    sprintf(line, "= %.10g", result);
+  printDisplay(line);
+
+  lcdSetCursor(3, 0); // Line 4
+  printDisplay("#:Run *:Edit 0:Exit");
+}
+
+int History_Show(char *src, ExprProgram *prog) {
+  double result;
+  int n = 0;
+
+  lcdCursorOff();
+  if (History_Get(n, src, prog, &result) < 0) {
+    lcdClearScreen();
+    printDisplay("History is empty");
+    SysTick_Wait10ms(100);
+    return HIST_EXIT;
+  }
+  History_Draw(n, src, result);
+
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(KEY_LAYER_HISTORY, k);
+
+      // Wait for release
+      while (readKeypad() != 0)
+        ;
+
+      if (c == KEY_ACT_EXIT)
+        return HIST_EXIT;
+      if (c == KEY_ACT_EVAL)
+        return HIST_RUN;
+      if (c == KEY_ACT_EDIT)
+        return HIST_EDIT;
+      if ((c == KEY_ACT_NEXT && n + 1 < g_count) ||
+          (c == KEY_ACT_PREV && n > 0)) {
+        n += (c == KEY_ACT_NEXT) ? 1 : -1; // Next: Older, Prev: Newer
+        if (History_Get(n, src, prog, &result) < 0)
+          return HIST_EXIT;
+        History_Draw(n, src, result);
+      }
+    }
+    SysTick_Wait10ms(5);
+  }
+}
@@ -0,0 +1,45 @@
+/*
+ * File: history.h
+ * Description: Public interface for the calculation history.
+ *              Expressions are kept nibble-packed in a RAM ring together
+ *              with their postfix operators, and mirrored to flash.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "Flash.h"
+#include "expr.h"
+
+// Ring size. The flash log is twice as big, so it is only erased once
+// every ring's worth of new entries
+#define HIST_BYTES (FLASH_HISTORY_SIZE / 2)
+
+// Longest expression kept, in tokens (src buffers need one more byte)
+#define HIST_MAX_SRC 254
+
+// History_Show results
+#define HIST_EXIT 0
+#define HIST_RUN 1  // Evaluate the entry again
+#define HIST_EDIT 2 // Load the entry into the editor
+
+// Load the ring from flash
+void History_Init(void);
+
+// Add an evaluated expression as the newest entry (oldest ones fall off)
+// Returns 0 on success, 1 if it is too long to keep
+int History_Add(const char *src, int len, const ExprProgram *prog,
+                double result);
+
+// Number of entries
+int History_Count(void);
+
+// Entry n (0 = newest): tokens into src (NUL-terminated) and the program
+// rebuilt without parsing. Returns the token count, -1 if there is none
+int History_Get(int n, char *src, ExprProgram *prog, double *result);
+
+// Browse the history. Keys: 2:Newer 8:Older #:Run *:Edit 0:Exit
+// On HIST_RUN and HIST_EDIT, src and prog hold the chosen entry
+int History_Show(char *src, ExprProgram *prog);
+
+#endif
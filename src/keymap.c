@@ -0,0 +1,92 @@
+/*
+ * File: keymap.c
+ * Description: The keypad layout. One line per key lists what it means in
+ *              every layer; the preprocessor turns each column into a flat
+ *              table. Adding a layer is a new column, not new code.
+ */
+
+#include "keymap.h"
+
+#include "expr.h"
+
+#define SH KEY_ACT_SHIFT
+#define EV KEY_ACT_EVAL
+#define BK KEY_ACT_BACK
+
+// clang-format off
+//  code  legend calc calcShift          calcCursor      base baseShift      baseHex pin  pager          menu number numShift history   matrix        matView
+#define KEYMAP(K)                                                              \
+  K(0x01, '1', '1', '(',              KEY_ACT_END,    '1', '(',           'A', '1', 0,            '1', '1',          0,   0,            '1',          0           ) \
+  K(0x02, '2', '2', ')',              0,              '2', ')',           'B', '2', 0,            '2', '2',          0,   KEY_ACT_PREV, '2',          0           ) \
+  K(0x04, '3', '3', EXPR_TOK_X,       0,              '3', '&',           'C', '3', 0,            '3', '3',          0,   0,            '3',          0           ) \
+  K(0x08, 'A', '+', EXPR_TOK_ANS,     KEY_ACT_MPLUS,  '+', KEY_ACT_WIDTH, 'A', 0,   0,            0,   KEY_ACT_NEXT, 0,   0,            KEY_ACT_SIZE, KEY_ACT_COPY) \
+  K(0x11, '4', '4', EXPR_TOK_SQRT,    KEY_ACT_LEFT,   '4', '|',           'D', '4', 0,            '4', '4',          0,   0,            '4',          0           ) \
+  K(0x12, '5', '5', EXPR_TOK_SIN,     0,              '5', '^',           'E', '5', 0,            '5', '5',          0,   0,            '5',          0           ) \
+  K(0x14, '6', '6', EXPR_TOK_COS,     KEY_ACT_RIGHT,  '6', '~',           'F', '6', 0,            '6', '6',          0,   0,            '6',          0           ) \
+  K(0x18, 'B', '-', '^',              KEY_ACT_MMINUS, '-', KEY_ACT_SIGN,  'B', 0,   0,            0,   '-',          0,   0,            0,            0           ) \
+  K(0x21, '7', '7', EXPR_TOK_LN,      KEY_ACT_HOME,   '7', '<',           0,   '7', 0,            '7', '7',          0,   0,            '7',          0           ) \
+  K(0x22, '8', '8', EXPR_TOK_EXP,     0,              '8', '>',           0,   '8', 0,            '8', '8',          0,   KEY_ACT_NEXT, 0,            0           ) \
+  K(0x24, '9', '9', KEY_ACT_FRACTION, 0,              '9', '%',           0,   '9', 0,            '9', '9',          0,   0,            0,            0           ) \
+  K(0x28, 'C', '*', '/',              KEY_ACT_STORE,  '*', '/',           'C', 0,   0,            0,   KEY_ACT_MENU, 0,   0,            0,            0           ) \
+  K(0x31, '*', BK,  KEY_ACT_HISTORY,  0,              BK,  0,             0,   BK,  KEY_ACT_PREV, 0,   BK,           0,   KEY_ACT_EDIT, 0,            KEY_ACT_PREV) \
+  K(0x32, '0', '0', '.',              0,              '0', KEY_ACT_BASE,  0,   '0', KEY_ACT_EXIT, 0,   '0',          '.', KEY_ACT_EXIT, KEY_ACT_EXIT, KEY_ACT_EXIT) \
+  K(0x34, '#', EV,  KEY_ACT_PIN,      0,              EV,  KEY_ACT_EXIT,  0,   EV,  KEY_ACT_NEXT, 0,   EV,           0,   EV,           0,            KEY_ACT_NEXT) \
+  K(0x38, 'D', SH,  SH,               SH,             SH,  SH,            SH,  0,   0,            0,   SH,           SH,  0,            0,            0           )
+// clang-format on
+
+// Column pickers: each expands one row into "[code] = value,"
+#define KEY_LEGEND(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,   \
+                   l13, l14)                                                   \
+  [c] = l0,
+#define KEY_CALC(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,     \
+                 l13, l14)                                                     \
+  [c] = l1,
+#define KEY_CALC_SHIFT(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,    \
+                       l12, l13, l14)                                          \
+  [c] = l2,
+#define KEY_CALC_CURSOR(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,   \
+                        l12, l13, l14)                                         \
+  [c] = l3,
+#define KEY_BASE(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,     \
+                 l13, l14)                                                     \
+  [c] = l4,
+#define KEY_BASE_SHIFT(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,    \
+                       l12, l13, l14)                                          \
+  [c] = l5,
+#define KEY_BASE_HEX(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,      \
+                     l12, l13, l14)                                            \
+  [c] = l6,
+#define KEY_PIN(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,      \
+                l13, l14)                                                      \
+  [c] = l7,
+#define KEY_PAGER(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,    \
+                  l13, l14)                                                    \
+  [c] = l8,
+#define KEY_MENU(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,     \
+                 l13, l14)                                                     \
+  [c] = l9,
+#define KEY_NUMBER(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,   \
+                   l13, l14)                                                   \
+  [c] = l10,
+#define KEY_NUMBER_SHIFT(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,  \
+                         l12, l13, l14)                                        \
+  [c] = l11,
+#define KEY_HISTORY(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,  \
+                    l13, l14)                                                  \
+  [c] = l12,
+#define KEY_MATRIX(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12,   \
+                   l13, l14)                                                   \
+  [c] = l13,
+#define KEY_MATRIX_VIEW(c, l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11,   \
+                        l12, l13, l14)                                         \
+  [c] = l14,
+
+const char g_keyLayers[KEY_NUM_LAYERS][KEY_CODES] = {
+    {KEYMAP(KEY_LEGEND)},        {KEYMAP(KEY_CALC)},
+    {KEYMAP(KEY_CALC_SHIFT)},    {KEYMAP(KEY_CALC_CURSOR)},
+    {KEYMAP(KEY_BASE)},          {KEYMAP(KEY_BASE_SHIFT)},
+    {KEYMAP(KEY_BASE_HEX)},      {KEYMAP(KEY_PIN)},
+    {KEYMAP(KEY_PAGER)},         {KEYMAP(KEY_MENU)},
+    {KEYMAP(KEY_NUMBER)},        {KEYMAP(KEY_NUMBER_SHIFT)},
+    {KEYMAP(KEY_HISTORY)},       {KEYMAP(KEY_MATRIX)},
+    {KEYMAP(KEY_MATRIX_VIEW)}};
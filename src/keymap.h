@@ -0,0 +1,64 @@
+/*
+ * File: keymap.h
+ * Description: Keypad layers. Every layer is a flat table indexed by the
+ *              raw code from readKeypad, so decoding is one table load.
+ */
+
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+// Raw codes are (row << 4) | column bit, always below 0x40
+#define KEY_CODES 0x40
+
+// Layers (CALC..CALC_CURSOR, BASE..BASE_HEX and NUMBER..NUMBER_SHIFT
+// follow each other so that the shift state can be added to the first one)
+#define KEY_LAYER_LEGEND 0        // Printed legend: 0-9, A-D, *, #
+#define KEY_LAYER_CALC 1          // Calculator
+#define KEY_LAYER_CALC_SHIFT 2    // Calculator after D
+#define KEY_LAYER_CALC_CURSOR 3   // Calculator after D twice
+#define KEY_LAYER_BASE 4          // Base mode
+#define KEY_LAYER_BASE_SHIFT 5    // Base mode after D
+#define KEY_LAYER_BASE_HEX 6      // Base mode A-F digits
+#define KEY_LAYER_PIN 7           // PIN entry
+#define KEY_LAYER_PAGER 8         // Tutorial pages and scrolling screens
+#define KEY_LAYER_MENU 9          // Main menu choices
+#define KEY_LAYER_NUMBER 10       // Number entry (prompts, Stats)
+#define KEY_LAYER_NUMBER_SHIFT 11 // Number entry after D
+#define KEY_LAYER_HISTORY 12      // History browser
+#define KEY_LAYER_MATRIX 13       // Matrix menu
+#define KEY_LAYER_MATRIX_VIEW 14  // Matrix results
+#define KEY_NUM_LAYERS 15
+
+// Actions. Codes below ' ' never clash with characters that get typed.
+#define KEY_NONE 0
+#define KEY_ACT_SHIFT 1    // Next layer
+#define KEY_ACT_EVAL 2     // Evaluate / confirm
+#define KEY_ACT_BACK 3     // Backspace
+#define KEY_ACT_HISTORY 4  // History browser
+#define KEY_ACT_FRACTION 5 // S<>D
+#define KEY_ACT_PIN 6      // Change PIN
+#define KEY_ACT_LEFT 7     // Cursor left
+#define KEY_ACT_RIGHT 8    // Cursor right
+#define KEY_ACT_HOME 9     // Cursor to start
+#define KEY_ACT_END 10     // Cursor to end
+#define KEY_ACT_MPLUS 11   // M+ (register follows)
+#define KEY_ACT_MMINUS 12  // M- (register follows)
+#define KEY_ACT_STORE 13   // Store (register follows)
+#define KEY_ACT_NEXT 14    // Next page
+#define KEY_ACT_PREV 15    // Previous page
+#define KEY_ACT_EXIT 16    // Leave the screen
+#define KEY_ACT_BASE 17    // Next number base
+#define KEY_ACT_WIDTH 18   // 32/64-bit words
+#define KEY_ACT_SIGN 19    // Signed/unsigned
+#define KEY_ACT_EDIT 20    // Edit the entry shown
+#define KEY_ACT_SIZE 21    // Next matrix size
+#define KEY_ACT_COPY 22    // Copy the result shown
+#define KEY_ACT_MENU 23    // Options for the screen
+
+// All layers, built at compile time from the table in keymap.c
+extern const char g_keyLayers[KEY_NUM_LAYERS][KEY_CODES];
+
+// Meaning of raw code 'code' in 'layer' (KEY_NONE if unmapped)
+#define Key_Map(layer, code) (g_keyLayers[(layer)][(code) & (KEY_CODES - 1)])
+
+#endif
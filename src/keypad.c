@@ -5,70 +5,70 @@
 
 #include "keypad.h"
 
-// --- Register Definitions ---
-// System Control
-#define SYSCTL_RCGCGPIO_R (*((volatile unsigned long *)0x400FE608))
-#define SYSCTL_PRGPIO_R (*((volatile unsigned long *)0x400FEA08))
+#include "gpio.h"
+#include "trace.h"
 
+// --- Register Definitions (AHB aperture, gpio.h) ---
 // Port D (Columns)
-#define GPIO_PORTD_DATA_R (*((volatile unsigned long *)0x400073FC))
-#define GPIO_PORTD_DIR_R (*((volatile unsigned long *)0x40007400))
-#define GPIO_PORTD_AFSEL_R (*((volatile unsigned long *)0x40007420))
-#define GPIO_PORTD_DEN_R (*((volatile unsigned long *)0x4000751C))
-#define GPIO_PORTD_PDR_R                                                       \
-  (*((volatile unsigned long *)0x40007514)) // Pull-down resistor
+#define GPIO_PORTD_AHB_DIR_R (*((volatile unsigned long *)0x4005B400))
+#define GPIO_PORTD_AHB_AFSEL_R (*((volatile unsigned long *)0x4005B420))
+#define GPIO_PORTD_AHB_DEN_R (*((volatile unsigned long *)0x4005B51C))
+#define GPIO_PORTD_AHB_PDR_R                                                   \
+  (*((volatile unsigned long *)0x4005B514)) // Pull-down resistor
 
 // Port E (Rows)
-#define GPIO_PORTE_DATA_R (*((volatile unsigned long *)0x400243FC))
-#define GPIO_PORTE_DIR_R (*((volatile unsigned long *)0x40024400))
-#define GPIO_PORTE_AFSEL_R (*((volatile unsigned long *)0x40024420))
-#define GPIO_PORTE_DEN_R (*((volatile unsigned long *)0x4002451C))
+#define GPIO_PORTE_AHB_DIR_R (*((volatile unsigned long *)0x4005C400))
+#define GPIO_PORTE_AHB_AFSEL_R (*((volatile unsigned long *)0x4005C420))
+#define GPIO_PORTE_AHB_DEN_R (*((volatile unsigned long *)0x4005C51C))
+
+// Bit-Specific Access (Masked Addresses): only PD0-PD3 and PE0-PE3
+#define KEYPAD_COLS (*((volatile unsigned long *)0x4005B03C))
+#define KEYPAD_ROWS (*((volatile unsigned long *)0x4005C03C))
+
+// Time for a driven row to reach the column inputs through a closed key
+// against the pull-downs. The old fixed loop gave about 7 us.
+#define KEYPAD_SETTLE_NS 2000
 
 // --- Core Functions ---
 
 // Initializes Port D and Port E
 void keypadInit(void) {
-  volatile unsigned long delay;
-
-  // 1. Activate Clock for Port D and Port E
-  SYSCTL_RCGCGPIO_R |= 0x18;
-  delay = SYSCTL_RCGCGPIO_R;
+  // 1. Activate Clock for Port D and Port E, on AHB
+  Gpio_Init(GPIO_PORT_D | GPIO_PORT_E);
 
   // 2. Configure Port E (Rows 0-3) as Output
-  GPIO_PORTE_AFSEL_R &= ~0x0F;
-  GPIO_PORTE_DIR_R |= 0x0F;
-  GPIO_PORTE_DEN_R |= 0x0F;
-  GPIO_PORTE_DATA_R &= ~0x0F;
+  GPIO_PORTE_AHB_AFSEL_R &= ~0x0F;
+  GPIO_PORTE_AHB_DIR_R |= 0x0F;
+  GPIO_PORTE_AHB_DEN_R |= 0x0F;
+  KEYPAD_ROWS = 0;
 
   // 3. Configure Port D (Cols 0-3) as Input with Pull-Downs
-  GPIO_PORTD_AFSEL_R &= ~0x0F;
-  GPIO_PORTD_DIR_R &= ~0x0F;
-  GPIO_PORTD_DEN_R |= 0x0F;
-  GPIO_PORTD_PDR_R |= 0x0F;
+  GPIO_PORTD_AHB_AFSEL_R &= ~0x0F;
+  GPIO_PORTD_AHB_DIR_R &= ~0x0F;
+  GPIO_PORTD_AHB_DEN_R |= 0x0F;
+  GPIO_PORTD_AHB_PDR_R |= 0x0F;
 }
 
 // Scans the matrix
-unsigned char readKeypad(void) {
+static unsigned char Keypad_Scan(void) {
   unsigned char row, col;
 
   // Loop through Rows (PE0-PE3)
   for (row = 0; row < 4; row++) {
     // Drive current row HIGH, others LOW
-    GPIO_PORTE_DATA_R = (1 << row);
+    KEYPAD_ROWS = (1 << row);
 
-    // Brief delay for signal stabilization
-    volatile int i;
-    for (i = 0; i < 100; i++)
-      ;
+    // Wait for the signal to settle
+    Gpio_Hold(GPIO_NS(KEYPAD_SETTLE_NS));
 
     // Read Columns (PD0-PD3)
-    col = GPIO_PORTD_DATA_R & 0x0F;
+    col = KEYPAD_COLS;
 
     if (col != 0) {
       // Key detected
 
       // Clean up row line
-      GPIO_PORTE_DATA_R = 0;
+      KEYPAD_ROWS = 0;
       return (row << 4) | col;
     }
   }
@@ -76,33 +76,5 @@ unsigned char readKeypad(void) {
   return 0; // No key pressed
 }
 
-// Decodes raw key code to ASCII
-char decodeKeyPress(unsigned char k) {
-  unsigned char row = (k >> 4);
-  unsigned char colData = (k & 0x0F);
-  unsigned char col = 0;
-
-  if (k == 0)
-    return 0;
-
-  // Resolve column bitmask to index
-  if (colData == 0x01)
-    col = 0;
-  else if (colData == 0x02)
-    col = 1;
-  else if (colData == 0x04)
-    col = 2;
-  else if (colData == 0x08)
-    col = 3;
-  else
-    return 0;
-
-
-
-  const char keyMap[4][4] = {{'1', '2', '3', 'A'},
-                             {'4', '5', '6', 'B'},
-                             {'7', '8', '9', 'C'},
-                             {'*', '0', '#', 'D'}};
-
-  return keyMap[row][col];
-}
+// Every scan goes through the trace recorder, which may replay instead
+unsigned char readKeypad(void) { return Trace_Key(Keypad_Scan()); }
@@ -12,7 +12,4 @@ void keypadInit(void);
 // Scans the keypad and returns the unique key code
 unsigned char readKeypad(void);
 
-// Converts the unique key code to an ASCII character
-char decodeKeyPress(unsigned char k);
-
 #endif /* KEYPAD_H_ */
@@ -5,51 +5,66 @@
 
 #include "lcd.h"
 
-// --- Register Definitions ---
-// System Control
-#define SYSCTL_RCGCGPIO_R (*((volatile unsigned long *)0x400FE608))
-#define SYSCTL_PRGPIO_R (*((volatile unsigned long *)0x400FEA08))
+#include "gpio.h"
+#include "power.h"
+#include "trace.h"
 
+#include <string.h>
+
+// --- Register Definitions (AHB aperture, gpio.h) ---
 // Port A (Control)
-#define GPIO_PORTA_DIR_R (*((volatile unsigned long *)0x40004400))
-#define GPIO_PORTA_AFSEL_R (*((volatile unsigned long *)0x40004420))
-#define GPIO_PORTA_DEN_R (*((volatile unsigned long *)0x4000451C))
+#define GPIO_PORTA_AHB_DIR_R (*((volatile unsigned long *)0x40058400))
+#define GPIO_PORTA_AHB_AFSEL_R (*((volatile unsigned long *)0x40058420))
+#define GPIO_PORTA_AHB_DEN_R (*((volatile unsigned long *)0x4005851C))
 
 // Port B (Data)
-#define GPIO_PORTB_DATA_R (*((volatile unsigned long *)0x400053FC))
-#define GPIO_PORTB_DIR_R (*((volatile unsigned long *)0x40005400))
-#define GPIO_PORTB_AFSEL_R (*((volatile unsigned long *)0x40005420))
-#define GPIO_PORTB_DEN_R (*((volatile unsigned long *)0x4000551C))
+#define GPIO_PORTB_AHB_DIR_R (*((volatile unsigned long *)0x40059400))
+#define GPIO_PORTB_AHB_AFSEL_R (*((volatile unsigned long *)0x40059420))
+#define GPIO_PORTB_AHB_DEN_R (*((volatile unsigned long *)0x4005951C))
+
+// Bit-specific access (masked addresses) is in lcd.h
 
-// Bit-Specific Access (Masked Addresses)
-#define LCD_EN_PIN (*((volatile unsigned long *)0x40004010)) 
-#define LCD_RS_PIN (*((volatile unsigned long *)0x40004020))
-#define LCD_DATA_PORT                                                          \
-  (*((volatile unsigned long *)0x4000503C))
+// HD44780 enable timing
+#define LCD_SETUP_NS 40      // tAS, RS to EN rising
+#define LCD_EN_HIGH_NS 450   // PWEH
+#define LCD_EN_CYCLE_NS 1000 // tcycE, high plus low
 
 // --- Timing Functions ---
 
-void lcdDelayUs(unsigned long us) {
-  volatile unsigned long count = us * 13;
-  while (count > 0) {
-    count--;
-  }
-}
+void lcdDelayUs(unsigned long us) { Gpio_Hold(us * PERF_CYCLES_PER_US); }
 
 void lcdDelayMs(unsigned long ms) {
+  int state = Power_Enter(POWER_LCD);
   while (ms > 0) {
     lcdDelayUs(1000);
     ms--;
   }
+  Power_Enter(state);
 }
 
 
+// Enable lines that latch the next byte
+#if LCD_CONTROLLERS == 2
+#define LCD_EN_PINS                                                            \
+  (*((volatile unsigned long *)0x40058050)) // PA2 and PA4
+#define LCD_EN_ALL 0x14
+#define LCD_EN_CTRL(c) ((c) ? 0x10 : 0x04)
+#define LCD_ENABLE_PINS 0x10 // PA4 besides PA2/PA3
+static unsigned char g_enable = LCD_EN_ALL;
+#define LCD_ENABLE g_enable
+#else
+#define LCD_EN_PINS LCD_EN_PIN
+#define LCD_ENABLE 0x04
+#define LCD_ENABLE_PINS 0x00
+#endif
+
 // Pulse the Enable (EN) pin to latch data
 void lcdENPulse(void) {
-  LCD_EN_PIN = 0x04; // Assert EN (High)
-  lcdDelayUs(1);     // Hold > 450ns
-  LCD_EN_PIN = 0x00; // De-assert EN (Low)
-  lcdDelayUs(1);     // Hold > 450ns
+  Gpio_Hold(GPIO_NS(LCD_SETUP_NS)); // AHB stores land back to back
+  LCD_EN_PINS = LCD_ENABLE;         // Assert EN (High)
+  Gpio_Hold(GPIO_NS(LCD_EN_HIGH_NS));
+  LCD_EN_PINS = 0x00; // De-assert EN (Low)
+  Gpio_Hold(GPIO_NS(LCD_EN_CYCLE_NS - LCD_EN_HIGH_NS));
 }
 
 // Send lower 4 bits of 'nibble' to LCD Data pins
@@ -60,65 +75,149 @@ void LCD_SendNibble(unsigned char nibble) {
 
 // Send a full byte as two nibbles (High then Low)
 void LCD_WriteByte(unsigned char data) {
+  int state;
+
   LCD_SendNibble((data >> 4) & 0x0F); // Upper nibble
   LCD_SendNibble(data & 0x0F);        // Lower nibble
-  lcdDelayUs(37);                     // Default execution time
+  state = Power_Enter(POWER_LCD);
+  lcdDelayUs(37); // Default execution time
+  Power_Enter(state);
+  Trace_Lcd(); // Key latency ends at the last byte
 }
 
 // --- Cursor Tracking ---
 static unsigned char g_col = 0;
-static unsigned char g_row = 0;
+static unsigned char g_row = 0; // LCD_ROWS or more: off the panel
+static unsigned char g_cursorOn = 0;
+
+// What DDRAM shows, updated with every write
+static char g_shadow[LCD_ROWS][LCD_COLS];
+
+// DDRAM address of the first cell of each row
+static const unsigned char g_rowBase[LCD_ROWS] = {
+    LCD_ROW_BASE(0), LCD_ROW_BASE(1),
+#if LCD_ROWS > 2
+    LCD_ROW_BASE(2), LCD_ROW_BASE(3),
+#endif
+};
+
+#if LCD_CONTROLLERS == 2
+// Address the controller that owns 'row'. The blinking cursor follows,
+// so only one controller shows it.
+static void LCD_Select(unsigned char row) {
+  unsigned char en = LCD_EN_CTRL(LCD_ROW_CTRL(row));
+
+  if (g_cursorOn && g_enable != en) {
+    LCD_RS_PIN = 0x00;
+    g_enable = LCD_EN_ALL ^ en;
+    LCD_WriteByte(0x0C); // Cursor off on the other one
+    g_enable = en;
+    LCD_WriteByte(0x0F);
+  }
+  g_enable = en;
+}
+#else
+#define LCD_Select(row) ((void)0)
+#endif
 
 static void LCD_UpdateCursor(void) {
-  unsigned char addr;
-  switch (g_row) {
-  case 0:
-    addr = 0x00;
-    break;
-  case 1:
-    addr = 0x40;
-    break;
-  case 2:
-    addr = 0x14;
-    break;
-  case 3:
-    addr = 0x54;
-    break;
-  default:
-    addr = 0x00;
-    break;
+  if (g_row >= LCD_ROWS)
+    return; // Off the panel: nothing to address
+  LCD_Select(g_row);
+  LCD_RS_PIN = 0x00;
+  LCD_WriteByte(0x80 | (g_rowBase[g_row] + g_col));
+}
+
+// Write n characters from (row, col) on, staying within the row. RS stays
+// high for the whole run and the address is only sent if the LCD is not
+// already there. Leaves g_col == LCD_COLS after the last column; the next
+// lcdWriteData wraps from there.
+static void LCD_WriteRun(unsigned char row, unsigned char col, const char *s,
+                         int n) {
+  if (n > LCD_COLS - col)
+    n = LCD_COLS - col;
+  if (n <= 0)
+    return;
+  if (row >= LCD_ROWS) {
+    g_row = row; // Dropped, but the cursor still moves
+    g_col = col + n;
+    return;
+  }
+  if (g_row != row || g_col != col) {
+    g_row = row;
+    g_col = col;
+    LCD_UpdateCursor();
+  }
+
+  LCD_RS_PIN = 0x08; // RS High (Data) for the whole run
+  while (n-- > 0) {
+    LCD_WriteByte((unsigned char)*s);
+    g_shadow[row][g_col++] = *s++;
   }
-  addr += g_col;
-  lcdWriteCommand(0x80 | addr);
+  LCD_RS_PIN = 0x00;
 }
 
 // --- Cursor Commands ---
 void lcdCursorBlink(void) {
+  g_cursorOn = 1;
+#if LCD_CONTROLLERS == 2
+  lcdWriteCommand(0x0C); // Off everywhere, then on where the cursor is
+  g_enable = 0;
+  LCD_UpdateCursor();
+#else
   lcdWriteCommand(0x0F); // Display On, Cursor On, Blink On
+#endif
 }
 
 void lcdCursorOff(void) {
+  g_cursorOn = 0;
   lcdWriteCommand(0x0C); // Display On, Cursor Off, Blink Off
 }
 
 // --- Core Functions ---
 
+// DDRAM addresses go to the selected controller; everything else (clear,
+// modes, CGRAM) to all of them
 void lcdWriteCommand(unsigned char c) {
+#if LCD_CONTROLLERS == 2
+  unsigned char en = g_enable;
+  if (!(c & 0x80))
+    g_enable = LCD_EN_ALL;
+#endif
   LCD_RS_PIN = 0x00; // RS Low (Command)
   LCD_WriteByte(c);
+#if LCD_CONTROLLERS == 2
+  g_enable = en;
+#endif
 }
 
 
 void lcdWriteData(char c) {
+  if (g_row >= LCD_ROWS) {
+    // Off the panel: dropped
+    if (++g_col >= LCD_COLS) {
+      g_col = 0;
+      g_row++;
+    }
+    return;
+  }
+  if (g_col >= LCD_COLS) {
+    // After a clipped run: continue on the next row
+    g_col = 0;
+    g_row = (g_row + 1) % LCD_ROWS;
+    LCD_UpdateCursor();
+  }
+
   LCD_RS_PIN = 0x08; // RS High (Data)
   LCD_WriteByte((unsigned char)c);
   LCD_RS_PIN = 0x00; // Cleanup
 
+  g_shadow[g_row][g_col] = c;
   g_col++;
-  if (g_col >= 20) { // Assuming 20x4 display
+  if (g_col >= LCD_COLS) {
     g_col = 0;
     g_row++;
-    if (g_row >= 4) {
+    if (g_row >= LCD_ROWS) {
       g_row = 0; // Wrap back to top
     }
     LCD_UpdateCursor();
@@ -132,56 +231,152 @@ void lcdClearScreen(void) {
   lcdDelayMs(2);
   g_col = 0;
   g_row = 0;
+  LCD_Select(0);
+  memset(g_shadow, ' ', sizeof(g_shadow));
 }
 
 // Move cursor to specific DDRAM address
 
 void lcdGoto(unsigned char address) {
-  lcdWriteCommand(0x80 | (address & 0x7F));
+  unsigned char row;
 
   // Calculate Row/Col logic derived from address
-
-  if (address >= 0x00 && address < 0x14) {
-    g_row = 0;
-    g_col = address;
-  } else if (address >= 0x40 && address < 0x54) {
-    g_row = 1;
-    g_col = address - 0x40;
-  } else if (address >= 0x14 && address < 0x28) {
-    g_row = 2;
-    g_col = address - 0x14;
-  } else if (address >= 0x54 && address < 0x68) {
-    g_row = 3;
-    g_col = address - 0x54;
-  } else {
-    g_col = 0;
-    g_row = 0;
+  for (row = 0; row < LCD_ROWS && LCD_ROW_CTRL(row) == 0; row++) {
+    if (address >= g_rowBase[row] && address < g_rowBase[row] + LCD_COLS) {
+      lcdSetCursor(row, address - g_rowBase[row]);
+      return;
+    }
   }
+  lcdSetCursor(0, 0);
 }
+
+void lcdSetCursor(unsigned char row, unsigned char col) {
+  g_row = row;
+  g_col = (col < LCD_COLS) ? col : LCD_COLS - 1;
+  LCD_UpdateCursor();
+}
+
 void printDisplay(char *str) {
   while (*str) {
-    lcdWriteData(*str++);
+    int n = 0;
+
+    if (g_col >= LCD_COLS) {
+      lcdWriteData(*str++); // After a clipped run
+      continue;
+    }
+    while (str[n] && n < LCD_COLS - g_col)
+      n++;
+    LCD_WriteRun(g_row, g_col, str, n);
+    str += n;
+    if (g_col >= LCD_COLS) {
+      // Wrap now, as lcdWriteData does, so a visible cursor follows
+      g_col = 0;
+      g_row = (g_row + 1) % LCD_ROWS;
+      LCD_UpdateCursor();
+    }
+  }
+}
+
+void lcdWriteAt(unsigned char row, unsigned char col, const char *str) {
+  int n = 0;
+
+  if (row >= LCD_ROWS || col >= LCD_COLS)
+    return;
+  while (str[n] && n < LCD_COLS - col)
+    n++;
+  LCD_WriteRun(row, col, str, n);
+}
+
+void lcdWriteRow(unsigned char row, const char *str) {
+  char line[LCD_COLS];
+  int n = 0;
+
+  if (row >= LCD_ROWS)
+    return;
+  while (str[n] && n < LCD_COLS) {
+    line[n] = str[n];
+    n++;
   }
+  while (n < LCD_COLS)
+    line[n++] = ' ';
+  LCD_WriteRun(row, 0, line, LCD_COLS);
 }
 
-void lcdCreateCustomChar(unsigned char loc, unsigned char *pattern) {
+void lcdWriteRect(unsigned char row, unsigned char col, unsigned char w,
+                  unsigned char h, const char *cells) {
+  unsigned char r;
+
+  for (r = 0; r < h && row + r < LCD_ROWS; r++)
+    LCD_WriteRun((unsigned char)(row + r), col, &cells[r * w], w);
+}
+
+void lcdCreateCustomChar(unsigned char loc, const unsigned char *pattern) {
   if (loc < 8) {
     int i;
     lcdWriteCommand(0x40 + (loc * 8));
+#if LCD_CONTROLLERS == 2
+    g_enable = LCD_EN_ALL; // Same glyph on both controllers
+#endif
+    LCD_RS_PIN = 0x08; // Data (CGRAM, not tracked)
     for (i = 0; i < 8; i++) {
-      lcdWriteData(pattern[i]);
+      LCD_WriteByte(pattern[i]);
+    }
+    LCD_RS_PIN = 0x00;
+    if (g_row >= LCD_ROWS)
+      lcdSetCursor(0, 0);
+    LCD_UpdateCursor(); // Back to DDRAM
+  }
+}
+
+int lcdShowsSlot(unsigned char loc) {
+  const char *cell = &g_shadow[0][0];
+  int i;
+
+  for (i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+    if ((unsigned char)cell[i] < 16 && (cell[i] & 7) == loc)
+      return 1;
+  }
+  return 0;
+}
+
+void lcdShowScreen(const char *image, int rows, int cols) {
+  unsigned char row, col;
+
+  for (row = 0; row < LCD_ROWS; row++) {
+    char line[LCD_COLS];
+    int n = (row < rows) ? ((cols < LCD_COLS) ? cols : LCD_COLS) : 0;
+
+    memset(line, ' ', sizeof(line));
+    if (n > 0)
+      memcpy(line, &image[row * cols], n);
+
+    col = 0;
+    while (col < LCD_COLS) {
+      unsigned char end;
+      if (g_shadow[row][col] == line[col]) {
+        col++;
+        continue;
+      }
+      // One run per block of changed cells
+      end = col + 1;
+      while (end < LCD_COLS && g_shadow[row][end] != line[end])
+        end++;
+      LCD_WriteRun(row, col, &line[col], end - col);
+      col = end;
     }
   }
 }
 
 // Deletes the previous character (Backspace)
 void lcdBackspace(void) {
+  if (g_row >= LCD_ROWS)
+    return;
   if (g_col > 0) {
     g_col--;
   } else {
     if (g_row > 0) {
       g_row--;
-      g_col = 19; // Go to end of previous line (0-19)
+      g_col = LCD_COLS - 1; // Go to end of previous line
     } else {
       return;
     }
@@ -193,6 +388,7 @@ void lcdBackspace(void) {
   LCD_RS_PIN = 0x08; // Data
   LCD_WriteByte(' ');
   LCD_RS_PIN = 0x00;
+  g_shadow[g_row][g_col] = ' ';
 
   LCD_UpdateCursor();
 }
@@ -200,25 +396,21 @@ void lcdBackspace(void) {
 // --- Initialization ---
 
 static void LCD_InitPorts(void) {
-  volatile unsigned long delay;
-
-
-  SYSCTL_RCGCGPIO_R |= 0x03;
-  delay = SYSCTL_RCGCGPIO_R;
+  Gpio_Init(GPIO_PORT_A | GPIO_PORT_B);
 
 
-  GPIO_PORTB_DIR_R |= 0x0F;
-  GPIO_PORTB_DEN_R |= 0x0F;
-  GPIO_PORTB_AFSEL_R &= ~0x0F;
+  GPIO_PORTB_AHB_DIR_R |= 0x0F;
+  GPIO_PORTB_AHB_DEN_R |= 0x0F;
+  GPIO_PORTB_AHB_AFSEL_R &= ~0x0F;
 
 
-  GPIO_PORTA_DIR_R |= 0x0C;
-  GPIO_PORTA_DEN_R |= 0x0C;
-  GPIO_PORTA_AFSEL_R &= ~0x0C;
+  GPIO_PORTA_AHB_DIR_R |= 0x0C | LCD_ENABLE_PINS;
+  GPIO_PORTA_AHB_DEN_R |= 0x0C | LCD_ENABLE_PINS;
+  GPIO_PORTA_AHB_AFSEL_R &= ~(0x0C | LCD_ENABLE_PINS);
 
 
   LCD_RS_PIN = 0x00;
-  LCD_EN_PIN = 0x00;
+  LCD_EN_PINS = 0x00;
 }
 
 // Main Initialization Routine
@@ -8,30 +8,83 @@
 
 /* Hardware Connections */
 
-#define LCD_EN_PIN (*((volatile unsigned long *)0x40004010))
-#define LCD_RS_PIN (*((volatile unsigned long *)0x40004020))
+#define LCD_EN_PIN (*((volatile unsigned long *)0x40058010)) // PA2, AHB
+#define LCD_RS_PIN (*((volatile unsigned long *)0x40058020)) // PA3, AHB
 
 /*
  * Data Lines (Port B):
  * DB4-DB7 -> PB0-PB3
  */
-#define LCD_DATA_PORT (*((volatile unsigned long *)0x4000503C))
+#define LCD_DATA_PORT (*((volatile unsigned long *)0x4005903C))
+
+/* Panel Geometry, chosen at build time (-DLCD_PANEL=LCD_PANEL_16X2) */
+#define LCD_PANEL_16X2 1
+#define LCD_PANEL_20X4 2
+#define LCD_PANEL_40X4 3 // Two controllers: EN1 (PA2) rows 0-1, EN2 (PA4) 2-3
+
+#ifndef LCD_PANEL
+#define LCD_PANEL LCD_PANEL_20X4
+#endif
+
+#if LCD_PANEL == LCD_PANEL_16X2
+#define LCD_ROWS 2
+#define LCD_COLS 16
+#define LCD_CONTROLLERS 1
+#elif LCD_PANEL == LCD_PANEL_20X4
+#define LCD_ROWS 4
+#define LCD_COLS 20
+#define LCD_CONTROLLERS 1
+#elif LCD_PANEL == LCD_PANEL_40X4
+#define LCD_ROWS 4
+#define LCD_COLS 40
+#define LCD_CONTROLLERS 2
+#else
+#error "Unknown LCD_PANEL"
+#endif
+
+// DDRAM address of the first cell of row r, and the controller it is on.
+// Both fold to constants for a constant r.
+#if LCD_CONTROLLERS == 2
+#define LCD_ROW_BASE(r) (((r) & 1) ? 0x40 : 0x00)
+#define LCD_ROW_CTRL(r) ((r) >> 1)
+#else
+#define LCD_ROW_BASE(r)                                                        \
+  ((((r) & 1) ? 0x40 : 0x00) + (((r) & 2) ? LCD_COLS : 0))
+#define LCD_ROW_CTRL(r) 0
+#endif
 
 /* Function Prototypes */
 void lcdInit(void);
 void lcdWriteCommand(unsigned char c);
 void lcdWriteData(char c);
 void lcdClearScreen(void);
-void lcdGoto(unsigned char address);
+void lcdGoto(unsigned char address); // First controller's DDRAM address
+void lcdSetCursor(unsigned char row, unsigned char col);
 void printDisplay(char *str);
 void lcdBackspace(void);
 
+// Bulk writes: one address command at most, RS held for the whole run.
+// Text is clipped at the end of the row rather than wrapped. Rows beyond
+// LCD_ROWS are dropped, so 4-line screens degrade to their top on 16x2.
+void lcdWriteAt(unsigned char row, unsigned char col, const char *str);
+void lcdWriteRow(unsigned char row, const char *str); // Padded to LCD_COLS
+void lcdWriteRect(unsigned char row, unsigned char col, unsigned char w,
+                  unsigned char h, const char *cells); // h rows of w cells
+
+// Show a rows x cols image (row by row) at the top left, with blanks
+// around it and anything past the panel clipped. Only the cells that
+// differ from what the LCD already shows are sent.
+void lcdShowScreen(const char *image, int rows, int cols);
+
 void lcdCursorBlink(void);
 void lcdCursorOff(void);
 
 //Custom Character
 // pattern must be 8 bytes
-void lcdCreateCustomChar(unsigned char loc, unsigned char *pattern);
+void lcdCreateCustomChar(unsigned char loc, const unsigned char *pattern);
+
+// 1 if CGRAM slot 'loc' (code loc or loc + 8) is on screen
+int lcdShowsSlot(unsigned char loc);
 
 void lcdDelayMs(unsigned long ms);
 
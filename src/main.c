@@ -4,41 +4,60 @@
  */
 
 #include "PLL.h"
+#include "bench.h"
 #include "SysTick.h"
 #include "calculator.h"
+#include "diag.h"
+#include "glyph.h"
+#include "keymap.h"
 #include "keypad.h"
 #include "lcd.h"
+#include "base.h"
+#include "matrix.h"
 #include "menu.h"
 #include "password.h"
+#include "perf.h"
+#include "power.h"
+#include "stack.h"
+#include "stats.h"
+#include "trace.h"
 
 int main(void) {
+  Stack_Paint(); // Before anything else runs deeper
+
   // System Initialization
   SysPLL_Init();
   SysTick_Init();
+  Perf_Init();
+  Power_Init();
 
   // Initialize Drivers
   lcdInit();
+  Glyph_Init();
   keypadInit();
   Calc_Init();
+  Trace_Init();
 
   // Intro: Loading Animation
   lcdClearScreen();
   lcdCursorOff(); // Ensure cursor is off
   printDisplay("Loading...");
-  lcdGoto(0x40); // 2nd Line
+  lcdSetCursor(1, 0); // 2nd Line
 
-  // Progress Bar Animation
+  // Progress Bar Animation: each cell fills one column at a time
   int i;
-  for (i = 0; i < 60; i++) {
-    lcdWriteData(0xFF);  // Display Block Character
-    SysTick_Wait10ms(2); // 20ms per block -> 1.2s total
+  for (i = 0; i < LCD_COLS * 5; i++) {
+    int part = i % 5;
+    lcdSetCursor(1, (unsigned char)(i / 5));
+    lcdWriteData(part == 4 ? (char)0xFF : Glyph_Use(GLYPH_BAR1 + part));
+    SysTick_Wait10ms(1); // 10ms per column -> 1s total
   }
   SysTick_Wait10ms(50);
 
   // Then Lock
   Password_Init(); // Clears screen and shows LOCKED
 
-  int appState = 0; // 0=Auth, 1=Menu, 2=Calc
+  int appState = 0; // 0=Auth, 1=Menu, 2=Calc/Table/Solve
 
   while (1) {
 
@@ -53,24 +72,46 @@ int main(void) {
         int choice = Menu_Select();
         if (choice == 1) {
           appState = 2; // Calculator
+          Calc_SetMode(CALC_MODE_NORMAL);
           Calc_Reset(); // Prepare Calculator
+        } else if (choice == 3) {
+          appState = 2; // Calculator, # tabulates f(X)
+          Calc_SetMode(CALC_MODE_TABLE);
+          Calc_Reset();
+        } else if (choice == 4) {
+          appState = 2; // Calculator, # solves f(X) = 0
+          Calc_SetMode(CALC_MODE_SOLVE);
+          Calc_Reset();
         } else if (choice == 2) {
           Tutorial_Show();
           // Return to Menu Loop
+        } else if (choice == 5) {
+          Bench_Show();
+          // Return to Menu Loop
+        } else if (choice == 6) {
+          Stats_Show();
+          // Return to Menu Loop
+        } else if (choice == 7) {
+          Mat_Show();
+          // Return to Menu Loop
+        } else if (choice == 8) {
+          Base_Show();
+          // Return to Menu Loop
+        } else if (choice == 9) {
+          if (Diag_Show())
+            Password_Lock(); // Traces start at the PIN screen
         }
       } else if (appState == 2) {
         // Calculator Mode
-        char key = readKeypad();
+        unsigned char key = readKeypad();
         if (key != 0) {
-          char decoded = decodeKeyPress(key);
-          // Pass key to calculator submodule
-
           // Check for Shortcuts
-          if (decoded == '#' && Calc_IsShiftActive()) {
+          if (Calc_IsShiftActive() &&
+              Key_Map(KEY_LAYER_CALC_SHIFT, key) == KEY_ACT_PIN) {
             Password_Change();
             Calc_Reset(); // Restore Calculator UI after return
-          } else {
-            Calc_ProcessKey(decoded);
+          } else if (Calc_ProcessKey(key)) {
+            appState = 1; // Back to the Menu
           }
 
           // Debounce
@@ -85,15 +126,16 @@ int main(void) {
     } else {
       // LOCKED STATE
       appState = 0;
-      char key = readKeypad();
+      unsigned char key = readKeypad();
       if (key != 0) {
-        char decoded = decodeKeyPress(key);
-        Password_Check(decoded);
+        Password_Check(key);
 
         // Debounce
         SysTick_Wait10ms(20);
         while (readKeypad() != 0)
           ;
+      } else {
+        Password_Idle(); // Hash the digits typed so far while waiting
       }
     }
   }
@@ -0,0 +1,444 @@
+/*
+ * File: matrix.c
+ * Description: Matrix mode. Single precision kernels specialized for
+ *              2x2, 3x3 and 4x4 at compile time, plus the entry and
+ *              result screens.
+ */
+
+#include "matrix.h"
+
+#include "SysTick.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "menu.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Pivot (or determinant) at or below this, relative to the largest
+// element, counts as singular
+#define MAT_EPS 1e-6f
+
+#define MAT_VISIBLE 3 // Result rows on screen (line 1 is the title)
+
+// Row r of a times column j of b, unrolled for each size
+#define MAT_DOT2(r, b, j) ((r)[0] * (b)[(j)] + (r)[1] * (b)[2 + (j)])
+#define MAT_DOT3(r, b, j)                                                      \
+  ((r)[0] * (b)[(j)] + (r)[1] * (b)[3 + (j)] + (r)[2] * (b)[6 + (j)])
+#define MAT_DOT4(r, b, j)                                                      \
+  ((r)[0] * (b)[(j)] + (r)[1] * (b)[4 + (j)] + (r)[2] * (b)[8 + (j)] +         \
+   (r)[3] * (b)[12 + (j)])
+
+// One multiply kernel per size. With N constant the compiler unrolls the
+// outer loops too, and each element is one chain of FPU multiply-adds.
+#define MAT_DEFINE_MUL(N)                                                      \
+  static void Mat_Mul##N(const float *a, const float *b, float *c) {           \
+    int i, j;                                                                  \
+    for (i = 0; i < N; i++) {                                                  \
+      for (j = 0; j < N; j++)                                                  \
+        c[i * N + j] = MAT_DOT##N(&a[i * N], b, j);                            \
+    }                                                                          \
+  }
+
+MAT_DEFINE_MUL(2)
+MAT_DEFINE_MUL(3)
+MAT_DEFINE_MUL(4)
+
+// Largest absolute element
+static float Mat_Scale(const float *m, int count) {
+  float s = 0.0f;
+  int i;
+  for (i = 0; i < count; i++) {
+    if (fabsf(m[i]) > s)
+      s = fabsf(m[i]);
+  }
+  return s;
+}
+
+static float Mat_Det2(const float *m) { return m[0] * m[3] - m[1] * m[2]; }
+
+static float Mat_Det3(const float *m) {
+  return m[0] * (m[4] * m[8] - m[5] * m[7]) -
+         m[1] * (m[3] * m[8] - m[5] * m[6]) +
+         m[2] * (m[3] * m[7] - m[4] * m[6]);
+}
+
+// Adjugate / det for 2x2 and 3x3. Returns 1 if singular
+static int Mat_Inverse2(const float *m, float *out) {
+  float s = Mat_Scale(m, 4);
+  float det = Mat_Det2(m);
+  float inv;
+
+  if (fabsf(det) <= MAT_EPS * s * s)
+    return 1;
+  inv = 1.0f / det;
+  out[0] = m[3] * inv;
+  out[1] = -m[1] * inv;
+  out[2] = -m[2] * inv;
+  out[3] = m[0] * inv;
+  return 0;
+}
+
+static int Mat_Inverse3(const float *m, float *out) {
+  float s = Mat_Scale(m, 9);
+  float det = Mat_Det3(m);
+  float inv;
+
+  if (fabsf(det) <= MAT_EPS * s * s * s)
+    return 1;
+  inv = 1.0f / det;
+  out[0] = (m[4] * m[8] - m[5] * m[7]) * inv;
+  out[1] = (m[2] * m[7] - m[1] * m[8]) * inv;
+  out[2] = (m[1] * m[5] - m[2] * m[4]) * inv;
+  out[3] = (m[5] * m[6] - m[3] * m[8]) * inv;
+  out[4] = (m[0] * m[8] - m[2] * m[6]) * inv;
+  out[5] = (m[2] * m[3] - m[0] * m[5]) * inv;
+  out[6] = (m[3] * m[7] - m[4] * m[6]) * inv;
+  out[7] = (m[1] * m[6] - m[0] * m[7]) * inv;
+  out[8] = (m[0] * m[4] - m[1] * m[3]) * inv;
+  return 0;
+}
+
+// Gauss-Jordan with partial pivoting on a 4x4 block followed by
+// cols - 4 right-hand columns. Returns the determinant, 0 if singular.
+static float Mat_Reduce4(float w[4][8], int cols, float scale) {
+  float det = 1.0f;
+  int col, r, k;
+
+  for (col = 0; col < 4; col++) {
+    int p = col;
+    float inv;
+
+    for (r = col + 1; r < 4; r++) {
+      if (fabsf(w[r][col]) > fabsf(w[p][col]))
+        p = r;
+    }
+    if (fabsf(w[p][col]) <= MAT_EPS * scale)
+      return 0.0f;
+    if (p != col) {
+      for (k = col; k < cols; k++) {
+        float t = w[p][k];
+        w[p][k] = w[col][k];
+        w[col][k] = t;
+      }
+      det = -det;
+    }
+
+    det *= w[col][col];
+    inv = 1.0f / w[col][col];
+    for (k = col; k < cols; k++)
+      w[col][k] *= inv;
+
+    for (r = 0; r < 4; r++) {
+      float f = w[r][col];
+      if (r == col || f == 0.0f)
+        continue;
+      for (k = col; k < cols; k++)
+        w[r][k] -= f * w[col][k];
+    }
+  }
+  return det;
+}
+
+// Copy a 4x4 matrix into the left block of a work array
+static void Mat_Load4(const float *m, float w[4][8]) {
+  int i;
+  for (i = 0; i < 4; i++)
+    memcpy(w[i], &m[i * 4], 4 * sizeof(float));
+}
+
+int Mat_Add(const Matrix *a, const Matrix *b, Matrix *out) {
+  int i;
+
+  if (a->n != b->n)
+    return 1;
+  out->n = a->n;
+  for (i = 0; i < a->n * a->n; i++)
+    out->m[i] = a->m[i] + b->m[i];
+  return 0;
+}
+
+int Mat_Mul(const Matrix *a, const Matrix *b, Matrix *out) {
+  float c[MAT_MAX * MAT_MAX]; // out may alias a or b
+
+  if (a->n != b->n)
+    return 1;
+  switch (a->n) {
+  case 2:
+    Mat_Mul2(a->m, b->m, c);
+    break;
+  case 3:
+    Mat_Mul3(a->m, b->m, c);
+    break;
+  case 4:
+    Mat_Mul4(a->m, b->m, c);
+    break;
+  default:
+    return 1;
+  }
+  out->n = a->n;
+  memcpy(out->m, c, (size_t)(a->n * a->n) * sizeof(float));
+  return 0;
+}
+
+int Mat_Det(const Matrix *a, float *det) {
+  float w[4][8];
+
+  switch (a->n) {
+  case 2:
+    *det = Mat_Det2(a->m);
+    return 0;
+  case 3:
+    *det = Mat_Det3(a->m);
+    return 0;
+  case 4:
+    Mat_Load4(a->m, w);
+    *det = Mat_Reduce4(w, 4, Mat_Scale(a->m, 16));
+    return 0;
+  default:
+    return 1;
+  }
+}
+
+int Mat_Inverse(const Matrix *a, Matrix *out) {
+  float w[4][8];
+  float c[MAT_MAX * MAT_MAX];
+  int i;
+
+  switch (a->n) {
+  case 2:
+    if (Mat_Inverse2(a->m, c))
+      return 1;
+    break;
+  case 3:
+    if (Mat_Inverse3(a->m, c))
+      return 1;
+    break;
+  case 4:
+    // [A | I] -> [I | inv(A)]
+    Mat_Load4(a->m, w);
+    for (i = 0; i < 4; i++) {
+      memset(&w[i][4], 0, 4 * sizeof(float));
+      w[i][4 + i] = 1.0f;
+    }
+    if (Mat_Reduce4(w, 8, Mat_Scale(a->m, 16)) == 0.0f)
+      return 1;
+    for (i = 0; i < 4; i++)
+      memcpy(&c[i * 4], &w[i][4], 4 * sizeof(float));
+    break;
+  default:
+    return 1;
+  }
+  out->n = a->n;
+  memcpy(out->m, c, (size_t)(a->n * a->n) * sizeof(float));
+  return 0;
+}
+
+int Mat_Solve(const Matrix *a, const float *b, float *x) {
+  float w[4][8];
+  Matrix inv;
+  int i;
+
+  if (a->n == 4) {
+    // [A | b] -> [I | x]
+    Mat_Load4(a->m, w);
+    for (i = 0; i < 4; i++)
+      w[i][4] = b[i];
+    if (Mat_Reduce4(w, 5, Mat_Scale(a->m, 16)) == 0.0f)
+      return 1;
+    for (i = 0; i < 4; i++)
+      x[i] = w[i][4];
+    return 0;
+  }
+
+  // Small sizes: closed-form inverse times b
+  if (Mat_Inverse(a, &inv))
+    return 1;
+  for (i = 0; i < a->n; i++) {
+    int k;
+    float s = 0.0f;
+    for (k = 0; k < a->n; k++)
+      s += inv.m[i * a->n + k] * b[k];
+    x[i] = s;
+  }
+  return 0;
+}
+
+// --- Screens ---
+
+static Matrix g_a = {2, {0}};
+static Matrix g_b = {2, {0}};
+static int g_n = 2;
+
+// Wait for the next key (released) and map it in 'layer'
+static char Mat_GetKey(int layer) {
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(layer, k);
+      while (readKeypad() != 0)
+        ; // Wait Release
+      return c;
+    }
+    SysTick_Wait10ms(5);
+  }
+}
+
+static void Mat_Message(char *msg) {
+  lcdClearScreen();
+  lcdCursorOff();
+  printDisplay(msg);
+  SysTick_Wait10ms(100);
+}
+
+// Change the size, keeping the overlapping top-left elements
+static void Mat_Resize(Matrix *m, int n) {
+  float old[MAT_MAX * MAT_MAX];
+  int i, j;
+
+  memcpy(old, m->m, sizeof(old));
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++)
+      m->m[i * n + j] = (i < m->n && j < m->n) ? old[i * m->n + j] : 0.0f;
+  }
+  m->n = n;
+}
+
+// Enter every element; # on an empty entry keeps the old value
+static void Mat_Edit(Matrix *m, char name) {
+  char prompt[48];
+  int i;
+
+  for (i = 0; i < m->n * m->n; i++) {
+    sprintf(prompt, "%c(%d,%d)=%.7g", name, i / m->n + 1, i % m->n + 1,
+            m->m[i]);
+    m->m[i] = (float)Menu_ReadNumber(prompt, m->m[i]);
+  }
+}
+
+// Scrollable list of values: "(i,j) value" for a matrix, "xi value" for
+// a vector (cols = 1). A copies a square result into A.
+static void Mat_View(char *title, const float *v, int rows, int cols) {
+  int count = rows * cols;
+  int first = 0;
+  int redraw = 1;
+
+  lcdCursorOff();
+  while (1) {
+    char c;
+
+    if (redraw) {
+      char line[48];
+      int r;
+
+      lcdClearScreen();
+      printDisplay(title);
+      for (r = 0; r < MAT_VISIBLE && first + r < count; r++) {
+        int k = first + r;
+        if (count == 1)
+          sprintf(line, "=%19.9g", v[k]);
+        else if (cols == 1)
+          sprintf(line, "x%d%17.7g", k + 1, v[k]);
+        else
+          sprintf(line, "(%d,%d)%14.7g", k / cols + 1, k % cols + 1, v[k]);
+        lcdSetCursor(r + 1, 0);
+        printDisplay(line);
+      }
+      redraw = 0;
+    }
+
+    c = Mat_GetKey(KEY_LAYER_MATRIX_VIEW);
+    if (c == KEY_ACT_EXIT)
+      return;
+    if (c == KEY_ACT_NEXT && first + MAT_VISIBLE < count) {
+      first++; // Scroll down
+      redraw = 1;
+    }
+    if (c == KEY_ACT_PREV && first > 0) {
+      first--; // Scroll up
+      redraw = 1;
+    }
+    if (c == KEY_ACT_COPY && cols > 1) {
+      g_a.n = cols;
+      memcpy(g_a.m, v, (size_t)count * sizeof(float));
+      Mat_Message("Copied to A");
+      return;
+    }
+  }
+}
+
+static void Mat_Draw(void) {
+  char line[32];
+
+  lcdClearScreen();
+  lcdCursorOff();
+  sprintf(line, "Matrix %dx%d  A:Size", g_n, g_n);
+  printDisplay(line);
+  lcdSetCursor(1, 0); // Line 2
+  printDisplay("1:Edit A  2:Edit B");
+  lcdSetCursor(2, 0); // Line 3
+  printDisplay("3:A+B 4:AxB 5:det");
+  lcdSetCursor(3, 0); // Line 4
+  printDisplay("6:inv 7:Ax=b 0:Exit");
+}
+
+void Mat_Show(void) {
+  Matrix r;
+  float x[MAT_MAX];
+  float b[MAT_MAX];
+  float det;
+  int i;
+
+  while (1) {
+    char c;
+
+    Mat_Draw();
+    c = Mat_GetKey(KEY_LAYER_MATRIX);
+
+    switch (c) {
+    case KEY_ACT_EXIT:
+      return;
+    case KEY_ACT_SIZE:
+      g_n = (g_n == MAT_MAX) ? 2 : g_n + 1;
+      Mat_Resize(&g_a, g_n);
+      Mat_Resize(&g_b, g_n);
+      break;
+    case '1':
+      Mat_Edit(&g_a, 'A');
+      break;
+    case '2':
+      Mat_Edit(&g_b, 'B');
+      break;
+    case '3':
+      Mat_Add(&g_a, &g_b, &r);
+      Mat_View("A+B     A:Copy to A", r.m, g_n, g_n);
+      break;
+    case '4':
+      Mat_Mul(&g_a, &g_b, &r);
+      Mat_View("AxB     A:Copy to A", r.m, g_n, g_n);
+      break;
+    case '5':
+      Mat_Det(&g_a, &det);
+      Mat_View("det A", &det, 1, 1);
+      break;
+    case '6':
+      if (Mat_Inverse(&g_a, &r))
+        Mat_Message("Singular matrix");
+      else
+        Mat_View("inv A   A:Copy to A", r.m, g_n, g_n);
+      break;
+    case '7':
+      for (i = 0; i < g_n; i++)
+        b[i] = g_b.m[i * g_n]; // b = first column of B
+      if (Mat_Solve(&g_a, b, x))
+        Mat_Message("Singular matrix");
+      else
+        Mat_View("Ax=b (b = B col 1)", x, g_n, 1);
+      break;
+    default:
+      break;
+    }
+  }
+}
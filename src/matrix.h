@@ -0,0 +1,33 @@
+/*
+ * File: matrix.h
+ * Description: Public interface for Matrix mode (2x2 to 4x4).
+ *              Elements are single precision, row-major and packed
+ *              (element (i,j) of an n x n matrix is m[i*n + j]).
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#define MAT_MAX 4
+
+typedef struct {
+  int n; // 2, 3 or 4
+  float m[MAT_MAX * MAT_MAX];
+} Matrix;
+
+// Kernels: return 0 on success, 1 on a size mismatch or a singular matrix.
+// out may be the same as an input.
+int Mat_Add(const Matrix *a, const Matrix *b, Matrix *out);
+int Mat_Mul(const Matrix *a, const Matrix *b, Matrix *out);
+int Mat_Det(const Matrix *a, float *det);
+int Mat_Inverse(const Matrix *a, Matrix *out);
+
+// Solve a*x = b for x (b and x hold a->n values)
+int Mat_Solve(const Matrix *a, const float *b, float *x);
+
+// Matrix screen
+// Keys: A:Size 1:Edit A 2:Edit B 3:A+B 4:AxB 5:det A 6:inv A
+//       7:Solve Ax=b (b = first column of B) 0:Exit
+void Mat_Show(void);
+
+#endif
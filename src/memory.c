@@ -0,0 +1,74 @@
+/*
+ * File: memory.c
+ * Description: Flash log for the memory registers.
+ *
+ * Record (7 words): [MEM_MAGIC | register][value (double)][exact value]
+ * Later records win. A full page is erased and rewritten with one
+ * record per register.
+ */
+
+#include "memory.h"
+
+#include "Flash.h"
+
+#include <string.h>
+
+#define MEM_MAGIC 0x4D450000 // "ME" in the upper half
+#define MEM_RECORD_WORDS 7
+
+static uint32_t g_next = 0; // Next free byte of the page, 0 = full/unknown
+
+// Write one record at g_next
+static void Mem_Write(const double *vals, const Rational *rats, int n) {
+  uint32_t rec[MEM_RECORD_WORDS];
+  int i;
+
+  rec[0] = MEM_MAGIC | (uint32_t)n;
+  memcpy(&rec[1], &vals[n], sizeof(double));
+  memcpy(&rec[3], &rats[n], sizeof(Rational));
+
+  for (i = 0; i < MEM_RECORD_WORDS; i++)
+    Flash_Write(FLASH_MEMORY_ADDR + g_next + 4 * i, rec[i]);
+  g_next += 4 * MEM_RECORD_WORDS;
+}
+
+void Mem_Init(double *vals, Rational *rats) {
+  uint32_t rec[MEM_RECORD_WORDS];
+  int n;
+  int i;
+
+  for (n = 0; n < EXPR_NUM_MEM; n++) {
+    vals[n] = 0.0;
+    rats[n].num = 0;
+    rats[n].den = 1;
+  }
+
+  // Replay records up to the first erased word
+  for (g_next = 0; g_next + 4 * MEM_RECORD_WORDS <= FLASH_PAGE_SIZE;
+       g_next += 4 * MEM_RECORD_WORDS) {
+    for (i = 0; i < MEM_RECORD_WORDS; i++)
+      rec[i] = Flash_Read(FLASH_MEMORY_ADDR + g_next + 4 * i);
+    n = (int)(rec[0] & 0xFFFF);
+    if ((rec[0] & 0xFFFF0000) != MEM_MAGIC || n >= EXPR_NUM_MEM)
+      break;
+    memcpy(&vals[n], &rec[1], sizeof(double));
+    memcpy(&rats[n], &rec[3], sizeof(Rational));
+  }
+
+  if (rec[0] != 0xFFFFFFFF)
+    g_next = 0; // Full or foreign data: rewrite on the first save
+}
+
+void Mem_Save(const double *vals, const Rational *rats, int n) {
+  int i;
+
+  if (g_next > 0 && g_next + 4 * MEM_RECORD_WORDS <= FLASH_PAGE_SIZE) {
+    Mem_Write(vals, rats, n);
+    return;
+  }
+
+  Flash_Erase(FLASH_MEMORY_ADDR);
+  g_next = 0;
+  for (i = 0; i < EXPR_NUM_MEM; i++)
+    Mem_Write(vals, rats, i);
+}
@@ -0,0 +1,21 @@
+/*
+ * File: memory.h
+ * Description: Public interface for saving the memory registers M1-M8.
+ *              Each change appends one record to a flash log, so the
+ *              page is only erased when the log is full.
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "expr.h"
+#include "rational.h"
+
+// Load all registers (0 if never stored). vals and rats hold
+// EXPR_NUM_MEM entries; rats[n].den == 0 means no exact value
+void Mem_Init(double *vals, Rational *rats);
+
+// Save register n (0 = M1) after it changed
+void Mem_Save(const double *vals, const Rational *rats, int n);
+
+#endif
@@ -6,122 +6,228 @@
 #include "menu.h"
 
 #include "SysTick.h"
+#include "keymap.h"
 #include "keypad.h"
 #include "lcd.h"
 
-// Helper to display a page and wait for navigation
-// Returns 1 to continue, 0 to exit (if * is pressed)
-// Returns: 1=Next, -1=Prev, 0=Exit
-int Tutorial_Page(char *title, char *l1, char *l2, int pageNum) {
-  lcdClearScreen();
-  printDisplay(title);
+#include <stdio.h>
+#include <stdlib.h>
 
-  if (l1) {
-    lcdGoto(0x40); // Line 2
-    printDisplay(l1);
-  }
-  if (l2) {
-    lcdGoto(0x14); // Line 3
-    printDisplay(l2);
-  }
+// Menu images are laid out for 20x4 and clipped or padded to the panel
+#define MENU_ROWS 4
+#define MENU_COLS 20
+
+// A screen of the menu tree: a prerendered image and where its keys lead
+typedef struct {
+  const char *image;   // MENU_ROWS * MENU_COLS characters, row by row
+  unsigned char layer; // Keymap layer read on this screen
+  signed char next;    // Screen for KEY_ACT_NEXT (-1 = leave)
+  signed char prev;    // Screen for KEY_ACT_PREV (-1 = leave)
+} MenuPage;
 
-  // Footer (Line 4)
-  lcdGoto(0x54);
-  printDisplay("      Page ");
-  lcdWriteData('0' + pageNum);
+// clang-format off
+static const MenuPage g_mainMenu[] = {
+    {"7.Mat  8.Base 9.Diag"
+     "1.Calc    2.Tutorial"
+     "3.Table   4.Solve   "
+     "5.Bench   6.Stats   ",
+     KEY_LAYER_MENU, -1, -1}};
+
+// Tutorial pages, in order. * on the first page stays there.
+static const MenuPage g_tutorial[] = {
+    // Controls Page
+    {"Tutorial Controls   "
+     "*:Back #:Next       "
+     "0:Exit              "
+     "      Page 1        ",
+     KEY_LAYER_PAGER, 1, 0},
+    // Basic Ops
+    {"Basic Keys          "
+     "A:+ B:- C:*         "
+     "D:Shift             "
+     "      Page 2        ",
+     KEY_LAYER_PAGER, 2, 0},
+    // Control Keys
+    {"Other Keys          "
+     "*:Bksp, empty: Menu "
+     "#:Evaluate          "
+     "      Page 3        ",
+     KEY_LAYER_PAGER, 3, 1},
+    // Shift Ops 1
+    {"Shift Ops 1         "
+     "Sh+A:Ans Sh+B:^     "
+     "Sh+C:Div (/)        "
+     "      Page 4        ",
+     KEY_LAYER_PAGER, 4, 2},
+    // Shift Ops 2
+    {"Shift Ops 2         "
+     "Sh+0:Dot (.)        "
+     "Sh+#:Change PIN     "
+     "      Page 5        ",
+     KEY_LAYER_PAGER, 5, 3},
+    // Shift Ops 3
+    {"Shift Ops 3         "
+     "Sh+1:( Sh+2:)       "
+     "-:Negate (-5)       "
+     "      Page 6        ",
+     KEY_LAYER_PAGER, 6, 4},
+    // Table Mode
+    {"Table Mode          "
+     "Sh+3:X  #:Tabulate  "
+     "#:Down *:Up 0:Exit  "
+     "      Page 7        ",
+     KEY_LAYER_PAGER, 7, 5},
+    // Solve Mode
+    {"Solve Mode          "
+     "f(X)# then guess X0 "
+     "# on empty:Benchmark"
+     "      Page 8        ",
+     KEY_LAYER_PAGER, 8, 6},
+    // Functions
+    {"Functions           "
+     "Sh+4:sqrt Sh+5:sin  "
+     "Sh+6:cos 7:ln 8:exp "
+     "      Page 9        ",
+     KEY_LAYER_PAGER, 9, 7},
+    // Fractions
+    {"Fractions           "
+     "Results are exact   "
+     "Sh+9:Fraction<>Dec  "
+     "      Page 10       ",
+     KEY_LAYER_PAGER, 10, 8},
+    // Editing
+    {"Editing (D twice)   "
+     "4:Left  6:Right     "
+     "7:Start 1:End       "
+     "      Page 11       ",
+     KEY_LAYER_PAGER, 11, 9},
+    // History
+    {"History (Sh+*)      "
+     "2:Newer 8:Older     "
+     "#:Run *:Edit 0:Exit "
+     "      Page 12       ",
+     KEY_LAYER_PAGER, 12, 10},
+    // Memory Registers
+    {"Memory (D twice)    "
+     "A:M+ B:M- C:Store   "
+     "Sh+A 1-8:Recall Mn  "
+     "      Page 13       ",
+     KEY_LAYER_PAGER, 13, 11},
+    // Statistics Mode
+    {"Stats Mode          "
+     "Type value #:Add    "
+     "A:Page *:Undo C:Menu"
+     "      Page 14       ",
+     KEY_LAYER_PAGER, 14, 12},
+    // Matrix Mode
+    {"Matrix Mode         "
+     "A:Size 2x2-4x4      "
+     "Ax=b: b=B column 1  "
+     "      Page 15       ",
+     KEY_LAYER_PAGER, 15, 13},
+    // Base Mode
+    {"Base Mode  Sh+#:Exit"
+     "Sh+0:Base Sh+A:32/64"
+     "Sh+B:Sign D,D:A-F   "
+     "      Page 16       ",
+     KEY_LAYER_PAGER, 16, 14},
+    // Base Mode Operators
+    {"Base Operators      "
+     "Sh+3:& 4:| 5:^ 6:~  "
+     "Sh+7:<< 8:>> 9:%    "
+     "      Page 17       ",
+     KEY_LAYER_PAGER, 17, 15},
+    // Diagnostics
+    {"Diagnostics (9)     "
+     "1:Record 2:Replay   "
+     "3:Baseline 4:Soak   "
+     "      Page 18       ",
+     KEY_LAYER_PAGER, -1, 16},
+};
+// clang-format on
+
+// Show screens of 'pages' from 'page' on, following navigation keys.
+// Only cells that differ from the LCD are sent on each flip.
+// Returns the first other mapped key, or KEY_ACT_EXIT when leaving.
+static char Menu_Run(const MenuPage *pages, int page) {
+  lcdCursorOff();
 
-  // Wait for key press
   while (1) {
-    unsigned char k = readKeypad();
-    if (k != 0) {
-      char c = decodeKeyPress(k);
+    unsigned char k;
+    char c;
 
-      // Wait for release
-      while (readKeypad() != 0)
-        ;
-
-      if (c == '0')
-        return 0; // Exit
-      if (c == '#')
-        return 1; // Next
-      if (c == '*')
-        return -1; // Prev
+    lcdShowScreen(pages[page].image, MENU_ROWS, MENU_COLS);
+
+    while ((k = readKeypad()) == 0)
+      SysTick_Wait10ms(5);
+    c = Key_Map(pages[page].layer, k);
+
+    // Wait for release
+    while (readKeypad() != 0)
+      ;
+
+    if (c == KEY_ACT_NEXT || c == KEY_ACT_PREV) {
+      page = (c == KEY_ACT_NEXT) ? pages[page].next : pages[page].prev;
+      if (page < 0)
+        return KEY_ACT_EXIT;
+    } else if (c != KEY_NONE) {
+      return c;
     }
-    SysTick_Wait10ms(5);
   }
 }
 
-int Menu_Select(void) {
+int Menu_Select(void) { return Menu_Run(g_mainMenu, 0) - '0'; }
+
+double Menu_ReadNumber(char *prompt, double def) {
+  char numStr[16];
+  int idx = 0;
+  int shift = 0;
+
   lcdClearScreen();
-  lcdCursorOff();
-  printDisplay("--- Main Menu ---");
-  lcdGoto(0x40); // Line 2
-  printDisplay("1. Calculator");
-  lcdGoto(0x14); // Line 3
-  printDisplay("2. Tutorial");
-  lcdGoto(0x54); // Line 4
-  printDisplay("Select Option [1-2]");
+  printDisplay(prompt);
+  lcdSetCursor(1, 0); // Line 2
+  lcdCursorBlink();
 
   while (1) {
     unsigned char k = readKeypad();
     if (k != 0) {
-      char c = decodeKeyPress(k);
-      if (c == '1') {
+      char c = Key_Map(KEY_LAYER_NUMBER + shift, k);
+      char ch = 0;
+
+      if (c == KEY_NONE)
+        c = Key_Map(KEY_LAYER_NUMBER, k); // Unshifted meaning
+
+      if ((c >= '0' && c <= '9') || c == '.')
+        ch = c;
+      else if (c == '-' && idx == 0)
+        ch = c; // Sign only at start
+      else if (c == KEY_ACT_SHIFT)
+        shift = !shift;
+      else if (c == KEY_ACT_BACK && idx > 0) {
+        idx--;
+        lcdBackspace();
+      } else if (c == KEY_ACT_EVAL) {
         while (readKeypad() != 0)
           ; // Wait Release
-        return 1;
+        numStr[idx] = '\0';
+        return (idx > 0) ? atof(numStr) : def;
       }
-      if (c == '2') {
-        while (readKeypad() != 0)
-          ; // Wait Release
-        return 2;
+
+      if (ch && idx < (int)sizeof(numStr) - 1) {
+        numStr[idx++] = ch;
+        lcdWriteData(ch);
+        shift = 0;
       }
+
+      SysTick_Wait10ms(20);
+      while (readKeypad() != 0)
+        ; // Wait Release
     }
-    SysTick_Wait10ms(5);
   }
 }
 
 void Tutorial_Show(void) {
-  int page = 1;
-  int result = 0;
-
-  while (page >= 1 && page <= 5) {
-    switch (page) {
-    case 1:
-      // Controls Page
-      result = Tutorial_Page("Tutorial Controls", "*:Back #:Next", "0:Exit", 1);
-      break;
-    case 2:
-      // Basic Ops
-      result = Tutorial_Page("Basic Keys", "A:+ B:- C:*", "D:Shift", 2);
-      break;
-    case 3:
-      // Control Keys
-      result = Tutorial_Page("Other Keys", "*:Backspace", "#:Evaluate", 3);
-      break;
-    case 4:
-      // Shift Ops 1
-      result =
-          Tutorial_Page("Shift Ops 1", "Sh+A:Ans Sh+B:^", "Sh+C:Div (/)", 4);
-      break;
-    case 5:
-      // Shift Ops 2
-      result =
-          Tutorial_Page("Shift Ops 2", "Sh+0:Dot (.)", "Sh+#:Change PIN", 5);
-      break;
-    }
-
-    if (result == 0)
-      break; // Exit
-    if (result == 1)
-      page++;
-    if (result == -1)
-      page--;
-
-    // Boundary
-    if (page < 1)
-      page = 1; // Can't go before 1
-  }
+  Menu_Run(g_tutorial, 0); // Until 0, or # on the last page
 
   // End
   lcdClearScreen();
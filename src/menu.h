@@ -8,9 +8,15 @@
 #define MENU_H
 
 // Displays Main Menu and waits for selection
-// Returns: 1 for Calculator, 2 for Tutorial
+// Returns: 1 for Calculator, 2 for Tutorial, 3 for Table, 4 for Solve,
+// 5 for Bench, 6 for Stats, 7 for Matrix, 8 for Base, 9 for Diagnostics
 int Menu_Select(void);
 
+// Prompts for a number on a cleared screen
+// Keys: digits, B:-, Sh+0:., *:Backspace, #:Confirm
+// Returns 'def' if confirmed empty
+double Menu_ReadNumber(char *prompt, double def);
+
 // Runs the Tutorial
 void Tutorial_Show(void);
 
@@ -1,103 +1,237 @@
 /*
  * File: password.c
  * Description: Password management module.
+ *
+ * Record at FLASH_PASSWORD_ADDR (words):
+ *   [magic][rounds | PASSWORD_WEAK][salt x4][hash x8]
+ * Older firmware kept the 4 PIN characters in the first word instead.
+ *
+ * The part has no random number generator, so salts come from a pool
+ * stirred with the cycle counter at every key press. At boot the pool
+ * has seen no keys, so a record migrated then is marked weak and gets a
+ * fresh salt at the first unlock.
+ *
+ * While a key trace replays, the record saved with the trace is used
+ * instead, and nothing is written back.
  */
 
+#include "password.h"
+
 #include "Flash.h"
 
 #include "SysTick.h"
+#include "glyph.h"
+#include "keymap.h"
 #include "keypad.h"
 #include "lcd.h"
+#include "perf.h"
+#include "sha256.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define PASSWORD_MAGIC 0x324E4950 // "PIN2"
+#define PASSWORD_WEAK 0x80000000  // Salted before any key was pressed
+#define PASSWORD_MAX_ROUNDS 0x00100000
+#define PASSWORD_LEN 4
+
 static int g_isUnlocked = 0;
 
 static char g_enteredPin[5]; // 4 digits
 static int g_pinIndex = 0;
-static char g_correctPin[5] = "1234"; // the Default PIN (allows change)
 
-void Password_Init(void) {
-  g_isUnlocked = 0;
+// Stored record
+static unsigned long g_rounds;
+static int g_weak;
+static uint8_t g_salt[PASSWORD_SALT_BYTES];
+static uint8_t g_hash[SHA256_BYTES];
+
+// Hash chain of the digits typed: g_chain[i] is the state after i digits.
+// Digit g_hashed is g_round rounds into g_chain[g_hashed + 1].
+static uint8_t g_chain[PASSWORD_LEN + 1][SHA256_BYTES];
+static int g_hashed = 0;
+static unsigned long g_round = 0;
+
+static uint8_t g_pool[SHA256_BYTES]; // Entropy for salts
+
+// Mix the time of this call into the pool
+static void Password_Stir(void) {
+  uint8_t buf[SHA256_BYTES + 4];
+  unsigned long c = Perf_Cycles();
+
+  memcpy(buf, g_pool, SHA256_BYTES);
+  memcpy(buf + SHA256_BYTES, &c, 4);
+  Sha256(buf, sizeof(buf), g_pool);
+}
+
+static void Password_NewSalt(uint8_t *salt) {
+  Password_Stir();
+  memcpy(salt, g_pool, PASSWORD_SALT_BYTES);
+  Password_Stir(); // The salt is public; the pool must not be
+}
+
+// One round for one digit: s = SHA-256(s || d)
+static void Password_Round(uint8_t *state, char digit) {
+  uint8_t buf[SHA256_BYTES + 1];
+
+  memcpy(buf, state, SHA256_BYTES);
+  buf[SHA256_BYTES] = (uint8_t)digit;
+  Sha256(buf, sizeof(buf), state);
+}
+
+void Password_Hash(const char *pin, const uint8_t *salt, unsigned long rounds,
+                   uint8_t *out) {
+  unsigned long r;
+  int i;
+
+  Sha256(salt, PASSWORD_SALT_BYTES, out);
+  for (i = 0; i < PASSWORD_LEN; i++)
+    for (r = 0; r < rounds; r++)
+      Password_Round(out, pin[i]);
+}
+
+// Run up to 'rounds' rounds on the digits typed so far
+static void Password_Work(unsigned long rounds) {
+  while (rounds > 0 && g_hashed < g_pinIndex) {
+    if (g_round == 0)
+      memcpy(g_chain[g_hashed + 1], g_chain[g_hashed], SHA256_BYTES);
+    Password_Round(g_chain[g_hashed + 1], g_enteredPin[g_hashed]);
+    rounds--;
+    if (++g_round == g_rounds) {
+      g_hashed++;
+      g_round = 0;
+    }
+  }
+}
+
+// Compare without an early exit, so timing says nothing about the hash
+static int Password_Equal(const uint8_t *a, const uint8_t *b) {
+  uint8_t diff = 0;
+  int i;
+
+  for (i = 0; i < SHA256_BYTES; i++)
+    diff |= a[i] ^ b[i];
+  return diff == 0;
+}
+
+// Hash 'pin' with a new salt and replace the record
+static void Password_Store(const char *pin, int weak) {
+  uint32_t words[PASSWORD_RECORD_WORDS];
+  int i;
+
+  Password_NewSalt(g_salt);
+  g_rounds = PASSWORD_ROUNDS;
+  g_weak = weak;
+  Password_Hash(pin, g_salt, g_rounds, g_hash);
+
+  words[0] = PASSWORD_MAGIC;
+  words[1] = g_rounds | (weak ? PASSWORD_WEAK : 0);
+  memcpy(&words[2], g_salt, PASSWORD_SALT_BYTES);
+  memcpy(&words[6], g_hash, SHA256_BYTES);
+
+  if (Trace_PinRecord())
+    return; // A replay must not change the live PIN
+
+  Flash_Erase(FLASH_PASSWORD_ADDR);
+  for (i = 0; i < PASSWORD_RECORD_WORDS; i++)
+    Flash_Write(FLASH_PASSWORD_ADDR + 4 * i, words[i]);
+}
+
+// The record in flash, or the trace's copy during a replay
+static void Password_Read(uint32_t *words) {
+  const uint32_t *trace = Trace_PinRecord();
+  int i;
+
+  for (i = 0; i < PASSWORD_RECORD_WORDS; i++)
+    words[i] = trace ? trace[i] : Flash_Read(FLASH_PASSWORD_ADDR + 4 * i);
+}
+
+// Take a hashed record. 0 = OK, 1 = Error (old or erased record)
+static int Password_Load(const uint32_t *words) {
+  if (words[0] != PASSWORD_MAGIC)
+    return 1;
+
+  g_rounds = words[1] & ~PASSWORD_WEAK;
+  g_weak = (words[1] & PASSWORD_WEAK) != 0;
+  if (g_rounds == 0 || g_rounds > PASSWORD_MAX_ROUNDS)
+    return 1;
+  memcpy(g_salt, &words[2], PASSWORD_SALT_BYTES);
+  memcpy(g_hash, &words[6], SHA256_BYTES);
+  return 0;
+}
+
+// Start a new entry: nothing typed, chain at the salt
+static void Password_Clear(void) {
   g_pinIndex = 0;
   memset(g_enteredPin, 0, sizeof(g_enteredPin));
+  memset(g_chain, 0, sizeof(g_chain));
+  Sha256(g_salt, PASSWORD_SALT_BYTES, g_chain[0]);
+  g_hashed = 0;
+  g_round = 0;
+}
 
-  Flash_Init();
-  // Load from Flash
-  uint32_t storedData = Flash_Read(FLASH_PASSWORD_ADDR);
+void Password_Init(void) {
+  uint32_t words[PASSWORD_RECORD_WORDS];
 
-  // 0xFFFFFFFF means erased. Use default.
-  if (storedData == 0xFFFFFFFF) {
-    strcpy(g_correctPin, "1234");
-  } else {
-    // Unpack 4 bytes
-    // Retrieve PIN from stored word
+  g_isUnlocked = 0;
 
-    memcpy(g_correctPin, &storedData, 4);
-    g_correctPin[4] = '\0';
+  Flash_Init();
+  Password_Stir();
 
-    // Validation: Check if it's actually 4 digits
+  Password_Read(words);
+  if (Password_Load(words)) {
+    // Old plaintext record (4 characters in the first word), or erased
+    char pin[5] = "1234"; // the Default PIN (allows change)
     int isValid = 1;
     int i;
+
+    memcpy(pin, &words[0], 4);
     for (i = 0; i < 4; i++) {
-      if (g_correctPin[i] < '0' || g_correctPin[i] > '9') {
+      if (pin[i] < '0' || pin[i] > '9')
         isValid = 0;
-        break;
-      }
     }
+    if (!isValid)
+      strcpy(pin, "1234");
 
-    if (!isValid) {
-      strcpy(g_correctPin, "1234");
-    }
+    Password_Store(pin, 1);
+    memset(pin, 0, sizeof(pin));
   }
 
-  // Load Custom Chars
-  // Lock Icon 
-  uint8_t lockChar[] = {0x0E, //  xxx
-                        0x11, // x   x
-                        0x11, // x   x
-                        0x1F, // xxxxx
-                        0x1B, // xx xx
-                        0x1B, // xx xx
-                        0x1F, // xxxxx
-                        0x00};
-  lcdCreateCustomChar(0, lockChar);
-
-  // Unlock Icon 
-  uint8_t unlockChar[] = {0x0E, //  xxx
-                          0x01, //     x
-                          0x01, //     x
-                          0x1F, // xxxxx
-                          0x1B, // xx xx
-                          0x1B, // xx xx
-                          0x1F, // xxxxx
-                          0x00};
-  lcdCreateCustomChar(1, unlockChar);
+  Password_Clear();
 
   lcdClearScreen();
   lcdCursorOff(); // Hide cursor on title screen
 
   printDisplay("--- LOCKED ");
-  lcdWriteData(0); // Show Lock Icon
+  lcdWriteData(Glyph_Use(GLYPH_LOCK)); // Uploaded only if not resident
 
   printDisplay(" ---");
 
-  lcdGoto(0x40);
+  lcdSetCursor(1, 0);
   printDisplay("Enter PIN:");
-  lcdGoto(0x14);    // Line 3
+  lcdSetCursor(2, 0);    // Line 3
   lcdCursorBlink(); // Show cursor for PIN input
 }
 
+void Password_Idle(void) {
+  if (!g_isUnlocked)
+    Password_Work(PASSWORD_IDLE_ROUNDS);
+}
+
 int Password_IsUnlocked(void) { return g_isUnlocked; }
 
 void Password_Lock(void) { Password_Init(); }
 
-void Password_Check(char key) {
+void Password_Check(unsigned char code) {
+  char key = Key_Map(KEY_LAYER_PIN, code);
+
   if (g_isUnlocked)
     return;
 
+  Password_Stir();
+
   // Only accept digits 0-9
   if (key >= '0' && key <= '9') {
     if (g_pinIndex < 4) {
@@ -105,25 +239,37 @@ void Password_Check(char key) {
       g_enteredPin[g_pinIndex] = '\0';
 
       lcdWriteData('*');
+      Password_Work(PASSWORD_KEY_ROUNDS);
     }
   }
   // Handle Delete (Backspace)
 
-  else if (key == '*') {
+  else if (key == KEY_ACT_BACK) {
     if (g_pinIndex > 0) {
       g_pinIndex--;
       g_enteredPin[g_pinIndex] = '\0';
+      if (g_hashed >= g_pinIndex) { // Back to the state before that digit
+        g_hashed = g_pinIndex;
+        g_round = 0;
+      }
       lcdBackspace();
     }
   }
   // Enter / Confirm (#)
-  else if (key == '#') {
-    if (strcmp(g_enteredPin, g_correctPin) == 0) {
+  else if (key == KEY_ACT_EVAL) {
+    int match;
+
+    Password_Work(PASSWORD_LEN * g_rounds); // Whatever idle time left over
+    match = Password_Equal(g_chain[PASSWORD_LEN], g_hash);
+    if (g_pinIndex == PASSWORD_LEN && match) {
+      if (g_weak)
+        Password_Store(g_enteredPin, 0); // Now the pool has key timings
+      Password_Clear();
       g_isUnlocked = 1;
       lcdClearScreen();
       lcdCursorOff(); // Hide during message
       printDisplay("Access Granted! ");
-      lcdWriteData(1);       // Show Unlock Icon
+      lcdWriteData(Glyph_Use(GLYPH_UNLOCK));
       SysTick_Wait10ms(100);
       lcdClearScreen();
       lcdCursorBlink();
@@ -135,13 +281,12 @@ void Password_Check(char key) {
       SysTick_Wait10ms(100);
 
       // Reset
-      g_pinIndex = 0;
-      memset(g_enteredPin, 0, sizeof(g_enteredPin));
+      Password_Clear();
       lcdClearScreen();
       printDisplay("--- LOCKED ---");
-      lcdGoto(0x40);
+      lcdSetCursor(1, 0);
       printDisplay("Enter PIN:");
-      lcdGoto(0x14);
+      lcdSetCursor(2, 0);
     }
   }
 }
@@ -153,30 +298,28 @@ void Password_Change(void) {
 
   lcdClearScreen();
   printDisplay("New PIN:");
-  lcdGoto(0x40);
+  lcdSetCursor(1, 0);
 
   while (1) {
     unsigned char k = readKeypad();
     if (k != 0) {
-      char c = decodeKeyPress(k);
+      char c = Key_Map(KEY_LAYER_PIN, k);
+
+      Password_Stir();
 
       if (c >= '0' && c <= '9') {
         if (idx < 4) {
           newPin[idx++] = c;
           lcdWriteData(c); // Show number
         }
-      } else if (c == '*' && idx > 0) { // Backspace
+      } else if (c == KEY_ACT_BACK && idx > 0) { // Backspace
         idx--;
         lcdBackspace();
-      } else if (c == '#' && idx == 4) { 
+      } else if (c == KEY_ACT_EVAL && idx == 4) { 
         newPin[4] = '\0';
-        strcpy(g_correctPin, newPin); // Store new PIN
-
-        // Save to Flash
-        Flash_Erase(FLASH_PASSWORD_ADDR);
-        uint32_t data = 0;
-        memcpy(&data, newPin, 4);
-        Flash_Write(FLASH_PASSWORD_ADDR, data);
+        Password_Store(newPin, 0); // Save the hash to Flash
+        memset(newPin, 0, sizeof(newPin));
+        Password_Clear(); // Next unlock starts from the new salt
 
         lcdClearScreen();
         lcdCursorOff(); // Hide
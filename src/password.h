@@ -1,17 +1,43 @@
 /*
  * File: password.h
  * Description: Public interface for the Password module.
+ *              The PIN is never stored. Flash holds a random salt and
+ *              H = f(f(f(f(SHA-256(salt), d1), d2), d3), d4), where
+ *              f(s, d) applies s = SHA-256(s || d) PASSWORD_ROUNDS times.
+ *              Each digit's rounds run as it is typed and while the
+ *              keypad is idle, so # only has to compare.
  */
 
 #ifndef PASSWORD_H
 
 #define PASSWORD_H
 
-// Initialize Password
+#include <stdint.h>
+
+// Work factor: hash rounds per digit. Saved with each record, so records
+// made with another value still verify; a PIN change uses this one.
+#ifndef PASSWORD_ROUNDS
+#define PASSWORD_ROUNDS 512
+#endif
+
+// Rounds run when a digit is typed, and per idle keypad poll
+#define PASSWORD_KEY_ROUNDS 512
+#define PASSWORD_IDLE_ROUNDS 32
+
+#define PASSWORD_SALT_BYTES 16
+
+// Words of the record at FLASH_PASSWORD_ADDR
+#define PASSWORD_RECORD_WORDS 14
+
+// Initialize Password. A plaintext PIN left in flash by older firmware
+// is replaced by a hashed record here.
 void Password_Init(void);
 
-// Process Key Input for Password
-void Password_Check(char key);
+// Process a raw key code from readKeypad for Password
+void Password_Check(unsigned char code);
+
+// Advance the hash of the digits typed so far; call while no key is down
+void Password_Idle(void);
 
 // Check if System is Unlocked
 // Returns 1 if Unlocked and then 0 if Locked
@@ -23,4 +49,8 @@ void Password_Lock(void);
 // Change Password
 void Password_Change(void);
 
+// Hash a 4-digit PIN as stored (SHA-256 size output)
+void Password_Hash(const char *pin, const uint8_t *salt, unsigned long rounds,
+                   uint8_t *out);
+
 #endif
@@ -0,0 +1,59 @@
+/*
+ * File: perf.c
+ * Description: Cycle-count instrumentation using the DWT unit.
+ */
+
+#include "perf.h"
+
+// Debug Registers
+#define CORE_DEMCR_R (*((volatile unsigned long *)0xE000EDFC))
+#define DWT_CTRL_R (*((volatile unsigned long *)0xE0001000))
+#define DWT_CYCCNT_R (*((volatile unsigned long *)0xE0001004))
+
+#define CORE_DEMCR_TRCENA 0x01000000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+
+static PerfStat g_stats[PERF_NUM_SLOTS];
+
+// Wide clock: total so far and the counter when it was last read
+static unsigned long long g_cycles64 = 0;
+static unsigned long g_cycles32 = 0;
+
+void Perf_Init(void) {
+  CORE_DEMCR_R |= CORE_DEMCR_TRCENA; // Enable trace blocks (DWT)
+  DWT_CYCCNT_R = 0;
+  DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+  g_cycles64 = 0;
+  g_cycles32 = 0;
+}
+
+unsigned long Perf_Cycles(void) { return DWT_CYCCNT_R; }
+
+unsigned long long Perf_Cycles64(void) {
+  unsigned long c = DWT_CYCCNT_R;
+
+  g_cycles64 += (unsigned long)(c - g_cycles32); // Modulo 2^32: one wrap
+  g_cycles32 = c;
+  return g_cycles64;
+}
+
+void Perf_Record(int slot, unsigned long cycles, unsigned long iters) {
+  PerfStat *s;
+
+  if (slot < 0 || slot >= PERF_NUM_SLOTS)
+    return;
+
+  s = &g_stats[slot];
+  s->count++;
+  s->lastCycles = cycles;
+  if (cycles > s->maxCycles)
+    s->maxCycles = cycles;
+  s->lastIters = iters;
+  s->totalIters += iters;
+}
+
+const PerfStat *Perf_Get(int slot) {
+  if (slot < 0 || slot >= PERF_NUM_SLOTS)
+    return 0;
+  return &g_stats[slot];
+}
@@ -0,0 +1,40 @@
+/*
+ * File: perf.h
+ * Description: Public interface for cycle-count instrumentation.
+ *              Uses the Cortex-M4 DWT cycle counter (80 MHz -> 12.5 ns).
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+// Instrumentation Slots
+#define PERF_SOLVE 0 // Equation solver (iters = Newton/secant/bisect steps)
+#define PERF_NUM_SLOTS 1
+
+#define PERF_CYCLES_PER_US 80
+
+typedef struct {
+  unsigned long count;      // Number of records
+  unsigned long lastCycles; // Duration of the last record
+  unsigned long maxCycles;  // Worst case seen
+  unsigned long lastIters;  // Iterations in the last record
+  unsigned long totalIters; // Iterations over all records
+} PerfStat;
+
+// Enable the DWT cycle counter
+void Perf_Init(void);
+
+// Current cycle count (wraps every ~53 s)
+unsigned long Perf_Cycles(void);
+
+// Cycles since Perf_Init, widened to 64 bits. Correct as long as it is
+// called at least once per wrap; every keypad poll and SysTick wait does.
+unsigned long long Perf_Cycles64(void);
+
+// Add one measurement to a slot
+void Perf_Record(int slot, unsigned long cycles, unsigned long iters);
+
+// Read a slot
+const PerfStat *Perf_Get(int slot);
+
+#endif /* PERF_H_ */
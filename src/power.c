@@ -0,0 +1,56 @@
+/*
+ * File: power.c
+ * Description: Energy model. State changes are charged to the state being
+ *              left, so reading the model costs nothing in between.
+ */
+
+#include "power.h"
+
+#include "perf.h"
+
+static const unsigned long g_ua[POWER_NUM_STATES] = {
+    POWER_RUN_UA, POWER_WAIT_UA, POWER_LCD_UA};
+
+static int g_state = POWER_RUN;
+static unsigned long long g_last = 0;
+static unsigned long long g_cycles[POWER_NUM_STATES];
+
+// Charge the cycles since the last call to the current state. The wide
+// clock keeps gaps longer than one DWT wrap (~53 s) whole.
+static void Power_Account(void) {
+  unsigned long long c = Perf_Cycles64();
+  g_cycles[g_state] += c - g_last;
+  g_last = c;
+}
+
+void Power_Init(void) {
+  int s;
+
+  for (s = 0; s < POWER_NUM_STATES; s++)
+    g_cycles[s] = 0;
+  g_state = POWER_RUN;
+  g_last = Perf_Cycles64();
+}
+
+int Power_Enter(int state) {
+  int prev = g_state;
+
+  Power_Account();
+  g_state = state;
+  return prev;
+}
+
+unsigned long long Power_Cycles(int state) {
+  Power_Account();
+  return g_cycles[state];
+}
+
+unsigned long long Power_Charge(void) {
+  unsigned long long pc = 0;
+  int s;
+
+  Power_Account();
+  for (s = 0; s < POWER_NUM_STATES; s++)
+    pc += g_cycles[s] * g_ua[s];
+  return pc / PERF_CYCLES_PER_US;
+}
@@ -0,0 +1,154 @@
+/*
+ * File: rational.c
+ * Description: Exact rational arithmetic on int64 pairs.
+ *              Every result is reduced with a binary GCD (shifts and
+ *              subtractions only, no 64-bit division in the loop), and
+ *              operands are cross-reduced first to delay overflow.
+ */
+
+#include "rational.h"
+
+// Magnitudes are kept below 2^63 so negation never overflows
+#define RAT_LIMIT 0x7FFFFFFFFFFFFFFFULL
+
+static uint64_t Rat_Abs(int64_t v) {
+  return (v < 0) ? (uint64_t)(-(v + 1)) + 1 : (uint64_t)v;
+}
+
+uint64_t Rat_Gcd(uint64_t a, uint64_t b) {
+  int shift;
+
+  if (a == 0)
+    return b;
+  if (b == 0)
+    return a;
+
+  shift = __builtin_ctzll(a | b); // Common factors of 2
+  a >>= __builtin_ctzll(a);
+
+  do {
+    b >>= __builtin_ctzll(b);
+    if (a > b) {
+      uint64_t t = a;
+      a = b;
+      b = t;
+    }
+    b -= a;
+  } while (b != 0);
+
+  return a << shift;
+}
+
+// Signed result from a sign and a magnitude
+static int Rat_Signed(int neg, uint64_t mag, int64_t *out) {
+  if (mag > RAT_LIMIT)
+    return 1;
+  *out = neg ? -(int64_t)mag : (int64_t)mag;
+  return 0;
+}
+
+int Rat_Make(int64_t num, int64_t den, Rational *out) {
+  uint64_t n, d, g;
+  int neg;
+
+  if (den == 0)
+    return 1;
+
+  neg = ((num < 0) != (den < 0));
+  n = Rat_Abs(num);
+  d = Rat_Abs(den);
+  g = Rat_Gcd(n, d);
+  if (g > 1) {
+    n /= g;
+    d /= g;
+  }
+  if (n == 0)
+    d = 1;
+
+  if (Rat_Signed(neg && n != 0, n, &out->num) || d > RAT_LIMIT)
+    return 1;
+  out->den = (int64_t)d;
+  return 0;
+}
+
+// a*b with overflow check
+static int Rat_MulCheck(int64_t a, int64_t b, int64_t *out) {
+  return __builtin_mul_overflow(a, b, out);
+}
+
+int Rat_Add(Rational a, Rational b, Rational *out) {
+  // a/b + c/d = (a*(d/g) + c*(b/g)) / (b/g*d), g = gcd(b, d)
+  int64_t g = (int64_t)Rat_Gcd((uint64_t)a.den, (uint64_t)b.den);
+  int64_t bg = a.den / g;
+  int64_t dg = b.den / g;
+  int64_t t1, t2, num, den;
+
+  if (Rat_MulCheck(a.num, dg, &t1) || Rat_MulCheck(b.num, bg, &t2) ||
+      __builtin_add_overflow(t1, t2, &num) || Rat_MulCheck(bg, b.den, &den))
+    return 1;
+  return Rat_Make(num, den, out);
+}
+
+int Rat_Sub(Rational a, Rational b, Rational *out) {
+  if (b.num == INT64_MIN)
+    return 1;
+  b.num = -b.num;
+  return Rat_Add(a, b, out);
+}
+
+int Rat_Mul(Rational a, Rational b, Rational *out) {
+  // Cross-reduce: (a/b)*(c/d) = ((a/g1)*(c/g2)) / ((b/g2)*(d/g1))
+  int64_t g1 = (int64_t)Rat_Gcd(Rat_Abs(a.num), (uint64_t)b.den);
+  int64_t g2 = (int64_t)Rat_Gcd(Rat_Abs(b.num), (uint64_t)a.den);
+  int64_t num, den;
+
+  if (g1 == 0)
+    g1 = 1;
+  if (g2 == 0)
+    g2 = 1;
+
+  if (Rat_MulCheck(a.num / g1, b.num / g2, &num) ||
+      Rat_MulCheck(a.den / g2, b.den / g1, &den))
+    return 1;
+  return Rat_Make(num, den, out);
+}
+
+int Rat_Div(Rational a, Rational b, Rational *out) {
+  Rational inv;
+
+  if (b.num == 0)
+    return 1; // Division by zero: let the float path decide
+  if (Rat_Make(b.den, b.num, &inv))
+    return 1;
+  return Rat_Mul(a, inv, out);
+}
+
+int Rat_Pow(Rational a, Rational b, Rational *out) {
+  Rational res = {1, 1};
+  int64_t n = b.num;
+  int neg = (n < 0);
+
+  if (b.den != 1)
+    return 1; // Fractional exponent is not rational in general
+  if (neg) {
+    if (a.num == 0 || n == INT64_MIN)
+      return 1;
+    n = -n;
+  }
+
+  // Square and multiply
+  while (n > 0) {
+    if ((n & 1) && Rat_Mul(res, a, &res))
+      return 1;
+    n >>= 1;
+    if (n > 0 && Rat_Mul(a, a, &a))
+      return 1;
+  }
+
+  if (neg)
+    return Rat_Div((Rational){1, 1}, res, out);
+  *out = res;
+  return 0;
+}
+
+double Rat_ToDouble(Rational a) { return (double)a.num / (double)a.den; }
@@ -0,0 +1,34 @@
+/*
+ * File: rational.h
+ * Description: Public interface for exact rational arithmetic.
+ *              Values are int64 num/den in lowest terms with den > 0.
+ */
+
+#ifndef RATIONAL_H
+#define RATIONAL_H
+
+#include <stdint.h>
+
+typedef struct {
+  int64_t num;
+  int64_t den; // Always > 0 when valid
+} Rational;
+
+// Binary (Stein) GCD
+uint64_t Rat_Gcd(uint64_t a, uint64_t b);
+
+// Build num/den in lowest terms
+// Returns 0 on success, 1 if den is 0 or a value does not fit
+int Rat_Make(int64_t num, int64_t den, Rational *out);
+
+// Arithmetic: returns 0 on success, 1 on overflow or division by zero.
+// On failure the caller falls back to floating point.
+int Rat_Add(Rational a, Rational b, Rational *out);
+int Rat_Sub(Rational a, Rational b, Rational *out);
+int Rat_Mul(Rational a, Rational b, Rational *out);
+int Rat_Div(Rational a, Rational b, Rational *out);
+int Rat_Pow(Rational a, Rational b, Rational *out); // b must be an integer
+
+double Rat_ToDouble(Rational a);
+
+#endif /* RATIONAL_H_ */
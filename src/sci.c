@@ -0,0 +1,213 @@
+/*
+ * File: sci.c
+ * Description: Scientific functions for the single-precision FPU.
+ *              Cody-Waite range reduction followed by short minimax
+ *              polynomials (Cephes coefficients), all in float so every
+ *              operation is one FPU instruction instead of a soft-double
+ *              library call.
+ */
+
+#include "sci.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// pi/2 split into 8, 11 and 11 significant bits plus a float tail, so
+// k*PIO2_1..3 are exact for |k| < 2^13 (|x| < SCI_TRIG_MAX needs
+// |k| <= 5215) and r keeps its relative accuracy next to a zero
+#define PIO2_1 1.5703125f
+#define PIO2_2 4.837512969970703125e-4f
+#define PIO2_3 7.54953362047672271729e-8f
+#define PIO2_4 2.56334406825708960298e-12f
+#define TWO_OVER_PI 0.636619772367581343f
+
+// ln(2) split the same way
+#define LN2_HI 0.693359375f
+#define LN2_LO -2.12194440e-4f
+#define LOG2E 1.44269504088896341f
+
+#define SQRT_HALF 0.707106781186547524f
+
+// Bit access without aliasing problems (compiles to VMOV)
+static float Sci_FromBits(uint32_t u) {
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static uint32_t Sci_ToBits(float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+float Sci_NaN(void) { return Sci_FromBits(0x7FC00000); }
+static float Sci_Inf(void) { return Sci_FromBits(0x7F800000); }
+
+// Round to nearest integer (ties away from zero)
+static int Sci_Round(float x) { return (int)(x + ((x < 0.0f) ? -0.5f : 0.5f)); }
+
+float Sci_Sqrt(float x) {
+  if (x < 0.0f)
+    return Sci_NaN();
+#if defined(__ARM_FP) && (__ARM_FP & 4)
+  __asm("vsqrt.f32 %0, %1" : "=t"(x) : "t"(x));
+  return x;
+#else
+  return __builtin_sqrtf(x);
+#endif
+}
+
+// sin(r) on [-pi/4, pi/4]
+static float Sci_SinPoly(float r) {
+  float z = r * r;
+  return ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) *
+             z * r +
+         r;
+}
+
+// cos(r) on [-pi/4, pi/4]
+static float Sci_CosPoly(float r) {
+  float z = r * r;
+  return ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z +
+          4.166664568298827e-2f) *
+             z * z -
+         0.5f * z + 1.0f;
+}
+
+// Reduce x to r in [-pi/4, pi/4], returns quadrant k mod 4
+static int Sci_ReducePio2(float x, float *r) {
+  int k = Sci_Round(x * TWO_OVER_PI);
+  float fk = (float)k;
+  *r = (((x - fk * PIO2_1) - fk * PIO2_2) - fk * PIO2_3) - fk * PIO2_4;
+  return k & 3;
+}
+
+float Sci_Sin(float x) {
+  float r;
+
+  if (!(x - x == 0.0f) || x > SCI_TRIG_MAX || x < -SCI_TRIG_MAX)
+    return Sci_NaN(); // Inf, NaN or too large to reduce
+
+  switch (Sci_ReducePio2(x, &r)) {
+  case 0:
+    return Sci_SinPoly(r);
+  case 1:
+    return Sci_CosPoly(r);
+  case 2:
+    return -Sci_SinPoly(r);
+  default:
+    return -Sci_CosPoly(r);
+  }
+}
+
+float Sci_Cos(float x) {
+  float r;
+
+  if (!(x - x == 0.0f) || x > SCI_TRIG_MAX || x < -SCI_TRIG_MAX)
+    return Sci_NaN();
+
+  switch (Sci_ReducePio2(x, &r)) {
+  case 0:
+    return Sci_CosPoly(r);
+  case 1:
+    return -Sci_SinPoly(r);
+  case 2:
+    return -Sci_CosPoly(r);
+  default:
+    return Sci_SinPoly(r);
+  }
+}
+
+float Sci_Exp(float x) {
+  float r, z, p;
+  int k;
+
+  if (x != x)
+    return x;
+  if (x > 88.72283905f)
+    return Sci_Inf();
+  if (x < -103.972084f)
+    return 0.0f;
+
+  // x = k*ln2 + r, |r| <= ln2/2
+  k = Sci_Round(x * LOG2E);
+  r = (x - (float)k * LN2_HI) - (float)k * LN2_LO;
+
+  z = r * r;
+  p = (((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) *
+             r +
+         4.1665795894e-2f) *
+            r +
+        1.6666665459e-1f) *
+           r +
+       5.0000001201e-1f) *
+          z +
+      r + 1.0f;
+
+  // Scale by 2^k through the exponent field (two steps near underflow)
+  if (k < -126) {
+    p *= Sci_FromBits((uint32_t)(k + 126 + 127) << 23);
+    return p * Sci_FromBits(1u << 23); // 2^-126
+  }
+  if (k > 127) {
+    p *= 2.0f;
+    k--;
+  }
+  return p * Sci_FromBits((uint32_t)(k + 127) << 23);
+}
+
+float Sci_Ln(float x) {
+  uint32_t u;
+  int e;
+  float m, z, y;
+
+  if (x != x || x < 0.0f)
+    return Sci_NaN();
+  if (x == 0.0f)
+    return -Sci_Inf();
+  if (x == Sci_Inf())
+    return x;
+
+  u = Sci_ToBits(x);
+  if ((u >> 23) == 0) { // Denormal: normalize first
+    x *= 16777216.0f;   // 2^24
+    u = Sci_ToBits(x);
+    e = -24;
+  } else {
+    e = 0;
+  }
+
+  // x = m * 2^e, m in [0.5, 1)
+  e += (int)(u >> 23) - 126;
+  m = Sci_FromBits((u & 0x007FFFFF) | 0x3F000000);
+
+  // Shift m into [sqrt(1/2), sqrt(2)) and take f = m - 1
+  if (m < SQRT_HALF) {
+    e--;
+    m = m + m - 1.0f;
+  } else {
+    m = m - 1.0f;
+  }
+
+  z = m * m;
+  y = ((((((((7.0376836292e-2f * m - 1.1514610310e-1f) * m +
+             1.1676998740e-1f) *
+                m -
+            1.2420140846e-1f) *
+               m +
+           1.4249322787e-1f) *
+              m -
+          1.6668057665e-1f) *
+             m +
+         2.0000714765e-1f) *
+            m -
+        2.4999993993e-1f) *
+           m +
+       3.3333331174e-1f) *
+      m * z;
+
+  y += LN2_LO * (float)e;
+  y -= 0.5f * z;
+  return (m + y) + LN2_HI * (float)e;
+}
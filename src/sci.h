@@ -0,0 +1,38 @@
+/*
+ * File: sci.h
+ * Description: Public interface for the single-precision scientific
+ *              function library.
+ *
+ * Error is the max against a double reference, in float ULPs of the
+ * result; sin and cos were measured over every float in range. Cost is
+ * FPU instructions on the straight-line path; the Bench screen measures
+ * actual cycles per call on the target.
+ *
+ *   Sci_Sqrt  0.5 ULP   x >= 0                   1 VSQRT (14 cycles)
+ *   Sci_Sin   1.52 ULP  |x| <= 64                ~18 FPU ops
+ *             2.34 ULP  |x| <= SCI_TRIG_MAX, abs error < 8.6e-8
+ *   Sci_Cos   1.53 ULP  |x| <= 64                ~18 FPU ops
+ *             2.33 ULP  |x| <= SCI_TRIG_MAX, abs error < 8.6e-8
+ *   Sci_Exp   1.0 ULP   -103.97 < x < 88.72      ~16 FPU ops
+ *   Sci_Ln    0.8 ULP   x > 0 (incl. denormals)  ~20 FPU ops
+ *
+ * Domain errors (sqrt/ln of a negative, trig beyond SCI_TRIG_MAX) return
+ * NaN. exp overflows to +Inf, ln(0) is -Inf.
+ */
+
+#ifndef SCI_H
+#define SCI_H
+
+// Largest |x| the trig range reduction keeps accurate
+#define SCI_TRIG_MAX 8192.0f
+
+// Quiet NaN, for callers with their own domain errors
+float Sci_NaN(void);
+
+float Sci_Sqrt(float x);
+float Sci_Sin(float x);
+float Sci_Cos(float x);
+float Sci_Exp(float x);
+float Sci_Ln(float x);
+
+#endif /* SCI_H_ */
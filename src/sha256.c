@@ -0,0 +1,137 @@
+/*
+ * File: sha256.c
+ * Description: SHA-256, one 64-byte block at a time. Small rather than
+ *              fast: the schedule is computed in place in 16 words.
+ */
+
+#include "sha256.h"
+
+#include <string.h>
+
+static const uint32_t g_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void Sha256_Block(Sha256Ctx *ctx, const uint8_t *p) {
+  uint32_t w[16];
+  uint32_t a, b, c, d, e, f, g, h;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+           ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+
+  a = ctx->h[0];
+  b = ctx->h[1];
+  c = ctx->h[2];
+  d = ctx->h[3];
+  e = ctx->h[4];
+  f = ctx->h[5];
+  g = ctx->h[6];
+  h = ctx->h[7];
+
+  for (i = 0; i < 64; i++) {
+    uint32_t t1, t2;
+
+    if (i >= 16) {
+      uint32_t w15 = w[(i - 15) & 15];
+      uint32_t w2 = w[(i - 2) & 15];
+      w[i & 15] += (ROR(w15, 7) ^ ROR(w15, 18) ^ (w15 >> 3)) +
+                   w[(i - 7) & 15] +
+                   (ROR(w2, 17) ^ ROR(w2, 19) ^ (w2 >> 10));
+    }
+
+    t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) +
+         g_k[i] + w[i & 15];
+    t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  ctx->h[0] += a;
+  ctx->h[1] += b;
+  ctx->h[2] += c;
+  ctx->h[3] += d;
+  ctx->h[4] += e;
+  ctx->h[5] += f;
+  ctx->h[6] += g;
+  ctx->h[7] += h;
+}
+
+void Sha256_Init(Sha256Ctx *ctx) {
+  static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                 0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                 0x1f83d9ab, 0x5be0cd19};
+  memcpy(ctx->h, iv, sizeof(iv));
+  ctx->len = 0;
+}
+
+void Sha256_Update(Sha256Ctx *ctx, const void *data, uint32_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+
+  while (len > 0) {
+    uint32_t used = ctx->len & 63;
+    uint32_t n = 64 - used;
+
+    if (n > len)
+      n = len;
+    memcpy(ctx->buf + used, p, n);
+    ctx->len += n;
+    p += n;
+    len -= n;
+    if ((ctx->len & 63) == 0)
+      Sha256_Block(ctx, ctx->buf);
+  }
+}
+
+void Sha256_Final(Sha256Ctx *ctx, uint8_t out[SHA256_BYTES]) {
+  uint32_t bits = ctx->len * 8;
+  uint32_t used = ctx->len & 63;
+  int i;
+
+  // 0x80, zeros, then the bit length big endian in the last 8 bytes
+  ctx->buf[used++] = 0x80;
+  if (used > 56) {
+    memset(ctx->buf + used, 0, 64 - used);
+    Sha256_Block(ctx, ctx->buf);
+    used = 0;
+  }
+  memset(ctx->buf + used, 0, 60 - used);
+  ctx->buf[60] = (uint8_t)(bits >> 24);
+  ctx->buf[61] = (uint8_t)(bits >> 16);
+  ctx->buf[62] = (uint8_t)(bits >> 8);
+  ctx->buf[63] = (uint8_t)bits;
+  Sha256_Block(ctx, ctx->buf);
+
+  for (i = 0; i < 8; i++) {
+    out[4 * i] = (uint8_t)(ctx->h[i] >> 24);
+    out[4 * i + 1] = (uint8_t)(ctx->h[i] >> 16);
+    out[4 * i + 2] = (uint8_t)(ctx->h[i] >> 8);
+    out[4 * i + 3] = (uint8_t)ctx->h[i];
+  }
+}
+
+void Sha256(const void *data, uint32_t len, uint8_t out[SHA256_BYTES]) {
+  Sha256Ctx ctx;
+
+  Sha256_Init(&ctx);
+  Sha256_Update(&ctx, data, len);
+  Sha256_Final(&ctx, out);
+}
@@ -0,0 +1,26 @@
+/*
+ * File: sha256.h
+ * Description: Public interface for SHA-256 (FIPS 180-4).
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+
+#define SHA256_BYTES 32
+
+typedef struct {
+  uint32_t h[8];
+  uint32_t len;    // Bytes hashed so far (messages stay far below 512 MB)
+  uint8_t buf[64]; // Partial block
+} Sha256Ctx;
+
+void Sha256_Init(Sha256Ctx *ctx);
+void Sha256_Update(Sha256Ctx *ctx, const void *data, uint32_t len);
+void Sha256_Final(Sha256Ctx *ctx, uint8_t out[SHA256_BYTES]);
+
+// One-shot digest of 'len' bytes
+void Sha256(const void *data, uint32_t len, uint8_t out[SHA256_BYTES]);
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * File: solve.c
+ * Description: Solve mode. Iterates on a compiled f(X) so the expression
+ *              text is parsed only once per solve.
+ */
+
+#include "solve.h"
+
+#include "SysTick.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "menu.h"
+#include "perf.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SOLVE_TOL 1e-12  // Relative step size that counts as converged
+#define SOLVE_FTOL 1e-6  // |f| relative to |f(x0)| accepted as a root
+#define SOLVE_PROBE 1e-4 // Relative derivative probe (float functions)
+#define SOLVE_HUGE 1e300 // Iterate escaped to infinity
+
+// Benchmark Set: expression and starting guess
+typedef struct {
+  const char *expr;
+  double x0;
+} SolveBench;
+
+static const SolveBench g_bench[] = {
+    {"X^2-2", 1.0},        // sqrt(2), well conditioned
+    {"X^3-2*X-5", 2.0},    // Wallis' cubic
+    {"X^3-X-1", 1.5},      // Plastic number
+    {"1/X-3", 0.2},        // Reciprocal
+    {"X^10-1", 0.5},       // Flat start, Newton overshoots
+    {"(X-1)^3", 2.0},      // Triple root, linear convergence
+    {"X^2+1", 0.5},        // No real root
+    {"X^5-X^4+X-5", 1.0},  // Quintic
+};
+
+#define SOLVE_NUM_BENCH (int)(sizeof(g_bench) / sizeof(g_bench[0]))
+
+static int Solve_IsBad(double v) { return !(fabs(v) < SOLVE_HUGE); } // NaN too
+
+int Solve_Find(const ExprProgram *prog, const double *ctx, double x0,
+               double *root, int *iters) {
+  double vars[EXPR_NUM_VARS];
+  double probe[2];
+  double fProbe[2];
+  double x = x0;
+  double fx;
+  double xPrev;
+  double fPrev;
+  double f0;
+  double lo = 0.0, flo = 0.0, hi = 0.0;
+  int haveBracket = 0;
+  int it;
+  unsigned long start = Perf_Cycles();
+
+  memcpy(vars, ctx, sizeof(vars));
+  vars[EXPR_VAR_X] = x;
+  fx = Expr_Run(prog, vars);
+  f0 = fx;
+
+  // Second point for the secant fallback
+  xPrev = x + 1e-3 * (fabs(x) + 1.0);
+  vars[EXPR_VAR_X] = xPrev;
+  fPrev = Expr_Run(prog, vars);
+
+  for (it = 1; it <= SOLVE_MAX_ITER; it++) {
+    double h = SOLVE_PROBE * (fabs(x) + 1.0);
+    double d;
+    double xn;
+    double fn;
+
+    if (fx == 0.0)
+      break;
+
+    // Central difference: both probes in one batch pass
+    probe[0] = x + h;
+    probe[1] = x - h;
+    Expr_RunBatch(prog, vars, probe, fProbe, 2);
+    d = (fProbe[0] - fProbe[1]) / (2.0 * h);
+
+    if (d != 0.0 && !Solve_IsBad(d))
+      xn = x - fx / d; // Newton
+    else if (fx != fPrev)
+      xn = x - fx * (x - xPrev) / (fx - fPrev); // Secant
+    else
+      break;
+
+    // Never leave a known bracket: bisect instead
+    if (haveBracket && (Solve_IsBad(xn) || xn < lo || xn > hi))
+      xn = 0.5 * (lo + hi);
+
+    if (Solve_IsBad(xn))
+      break;
+
+    vars[EXPR_VAR_X] = xn;
+    fn = Expr_Run(prog, vars);
+
+    // Tiny step that made f worse: at the noise floor, keep x
+    if (fabs(fn) >= fabs(fx) && fabs(xn - x) <= SOLVE_FTOL * (fabs(x) + 1.0))
+      break;
+
+    // Keep [lo, hi] around a sign change
+    if (!haveBracket) {
+      if ((fn < 0.0) != (fx < 0.0)) {
+        lo = (x < xn) ? x : xn;
+        hi = (x < xn) ? xn : x;
+        flo = (x < xn) ? fx : fn;
+        haveBracket = 1;
+      }
+    } else if ((fn < 0.0) == (flo < 0.0)) {
+      lo = xn;
+      flo = fn;
+    } else {
+      hi = xn;
+    }
+
+    xPrev = x;
+    fPrev = fx;
+    x = xn;
+    fx = fn;
+
+    if (fabs(x - xPrev) <= SOLVE_TOL * (fabs(x) + 1.0))
+      break;
+  }
+
+  if (it > SOLVE_MAX_ITER)
+    it = SOLVE_MAX_ITER;
+
+  Perf_Record(PERF_SOLVE, Perf_Cycles() - start, (unsigned long)it);
+
+  *root = x;
+  *iters = it;
+
+  // Accept only if f is actually small at the final point
+  if (Solve_IsBad(fx) || fabs(fx) > SOLVE_FTOL * (fabs(f0) + 1.0))
+    return 1;
+  return 0;
+}
+
+// Show iterations and time from the last solve on Line 3
+static void Solve_ShowStats(int iters) {
+  const PerfStat *s = Perf_Get(PERF_SOLVE);
+  char line[24];
+
+  lcdSetCursor(2, 0); // Line 3
+  sprintf(line, "it=%d t=%luus", iters, s->lastCycles / PERF_CYCLES_PER_US);
+  printDisplay(line);
+}
+
+// Wait for any key and its release
+static void Solve_WaitKey(void) {
+  while (readKeypad() == 0)
+    SysTick_Wait10ms(5);
+  while (readKeypad() != 0)
+    ;
+}
+
+int Solve_Show(const ExprProgram *prog, const double *ctx, double *root) {
+  double x0 = Menu_ReadNumber("Guess X0:", 0.0);
+  double vars[EXPR_NUM_VARS];
+  char line[24];
+  int iters;
+  int status;
+
+  lcdClearScreen();
+  lcdCursorOff();
+  printDisplay("Solving...");
+
+  status = Solve_Find(prog, ctx, x0, root, &iters);
+
+  lcdClearScreen();
+  if (status == 0) {
+    sprintf(line, "X=%.12g", *root);
+    printDisplay(line);
+    lcdSetCursor(1, 0); // Line 2
+    memcpy(vars, ctx, sizeof(vars));
+    vars[EXPR_VAR_X] = *root;
+    sprintf(line, "f(X)=%.4g", Expr_Run(prog, vars));
+    printDisplay(line);
+  } else {
+    printDisplay("No root found");
+  }
+  Solve_ShowStats(iters);
+  lcdSetCursor(3, 0); // Line 4
+  printDisplay("Press any key");
+
+  Solve_WaitKey();
+  return status;
+}
+
+void Solve_Benchmark(void) {
+  static ExprProgram prog; // Too big for the stack
+  static const double vars[EXPR_NUM_VARS]; // All zero
+  char line[24];
+  int i;
+
+  lcdCursorOff();
+
+  for (i = 0; i < SOLVE_NUM_BENCH; i++) {
+    double root = 0.0;
+    int iters = 0;
+    int errorPos;
+    int status = 1;
+
+    if (Expr_Compile(g_bench[i].expr, strlen(g_bench[i].expr), &prog,
+                     &errorPos) == 0)
+      status = Solve_Find(&prog, vars, g_bench[i].x0, &root, &iters);
+
+    lcdClearScreen();
+    sprintf(line, "Bench %d/%d", i + 1, SOLVE_NUM_BENCH);
+    printDisplay(line);
+    lcdSetCursor(1, 0); // Line 2
+    printDisplay((char *)g_bench[i].expr);
+    Solve_ShowStats(iters);
+    lcdSetCursor(3, 0); // Line 4
+    if (status == 0)
+      sprintf(line, "X=%.10g", root);
+    else
+      sprintf(line, "No root");
+    printDisplay(line);
+
+    // Wait for # (next) or 0 (exit)
+    while (1) {
+      unsigned char k = readKeypad();
+      if (k != 0) {
+        char c = Key_Map(KEY_LAYER_PAGER, k);
+        while (readKeypad() != 0)
+          ;
+        if (c == KEY_ACT_EXIT)
+          return;
+        if (c == KEY_ACT_NEXT)
+          break;
+      }
+      SysTick_Wait10ms(5);
+    }
+  }
+}
@@ -0,0 +1,30 @@
+/*
+ * File: solve.h
+ * Description: Public interface for Solve mode (find X where f(X) = 0).
+ */
+
+#ifndef SOLVE_H
+#define SOLVE_H
+
+#include "expr.h"
+
+#define SOLVE_MAX_ITER 60
+
+// Find a root of f starting from x0.
+// Newton's method with a central-difference derivative, falling back to
+// secant when the derivative vanishes and to bisection once a sign change
+// has been bracketed.
+// vars[] supplies every variable except X
+// Returns 0 on success (root, iters set), 1 if no root was found
+int Solve_Find(const ExprProgram *prog, const double *vars, double x0,
+               double *root, int *iters);
+
+// Prompts for the starting guess, solves and shows the result
+// Returns 0 and sets root on success, 1 on failure
+int Solve_Show(const ExprProgram *prog, const double *vars, double *root);
+
+// Solves a fixed set of functions and shows iterations and time for each
+// Keys: #:Next 0:Exit
+void Solve_Benchmark(void);
+
+#endif
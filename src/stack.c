@@ -0,0 +1,49 @@
+/*
+ * File: stack.c
+ * Description: Stack painting and high-water mark.
+ *              The stack is the STACK section of the startup file. armlink
+ *              defines $$Base and $$Limit symbols for every input section
+ *              and the ZI limit of the RAM region.
+ */
+
+#include "stack.h"
+
+extern unsigned long STACK$$Base;
+extern unsigned long STACK$$Limit;
+extern unsigned long Image$$RW_IRAM1$$Base;
+extern unsigned long Image$$RW_IRAM1$$ZI$$Limit;
+
+#define STACK_BOTTOM (&STACK$$Base)
+#define STACK_TOP (&STACK$$Limit) // Stack grows down from here
+
+// Paints from STACK$$Base up to STACK_GUARD_WORDS below the current SP.
+// The live frames above that (this one, main's locals and the return
+// address) are left alone; the guard covers what the loop itself pushes.
+void Stack_Paint(void) {
+  volatile unsigned long here; // Approximates the current SP
+  unsigned long *p = STACK_BOTTOM;
+  unsigned long *end = (unsigned long *)&here - STACK_GUARD_WORDS;
+
+  while (p < end)
+    *p++ = STACK_PAINT;
+}
+
+unsigned long Stack_Size(void) {
+  return (unsigned long)((char *)STACK_TOP - (char *)STACK_BOTTOM);
+}
+
+unsigned long Stack_HighWater(void) {
+  const unsigned long *p = STACK_BOTTOM;
+
+  // Words are used from the top, so the first unpainted word going up
+  // from the bottom is the deepest one
+  while (p < STACK_TOP && *p == STACK_PAINT)
+    p++;
+  return (unsigned long)((char *)STACK_TOP - (char *)p);
+}
+
+unsigned long Stack_StaticRam(void) {
+  return (unsigned long)((char *)&Image$$RW_IRAM1$$ZI$$Limit -
+                         (char *)&Image$$RW_IRAM1$$Base) -
+         Stack_Size();
+}
@@ -0,0 +1,35 @@
+/*
+ * File: stack.h
+ * Description: Public interface for stack depth measurement.
+ *              The free part of the stack is painted at boot; the deepest
+ *              point ever reached is where the paint stops.
+ *
+ *              The static side comes from the linker: the project asks
+ *              armlink for --info=stack,sizes,totals and --callgraph, so
+ *              every build lists RAM per module and the worst-case stack
+ *              depth of each function (calc.htm). Recursive or indirect
+ *              calls make that figure a lower bound; the painted mark
+ *              covers what actually ran.
+ */
+
+#ifndef STACK_H
+#define STACK_H
+
+#define STACK_PAINT 0xC5C5C5C5
+
+// Words under the caller's frame left unpainted as a margin
+#define STACK_GUARD_WORDS 16
+
+// Paint the unused stack. Call first thing in main.
+void Stack_Paint(void);
+
+// Bytes reserved for the stack
+unsigned long Stack_Size(void);
+
+// Most bytes ever in use since Stack_Paint
+unsigned long Stack_HighWater(void);
+
+// Bytes of static RAM (data and zero-init, stack excluded)
+unsigned long Stack_StaticRam(void);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * File: stats.c
+ * Description: Statistics mode. Running count, sum, mean, variance,
+ *              min, max and a trend line, updated per sample in O(1).
+ */
+
+#include "stats.h"
+
+#include "SysTick.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STATS_PAGES 5
+
+static StatsAcc g_acc;
+
+#if STATS_LOG_SIZE > 0
+static double g_log[STATS_LOG_SIZE]; // Oldest first, as passed to Stats_Add
+#endif
+
+void Stats_Clear(StatsAcc *s) {
+  s->n = 0;
+  s->sum = 0.0;
+  s->mean = 0.0;
+  s->m2 = 0.0;
+  s->cxy = 0.0;
+  s->min = 0.0;
+  s->max = 0.0;
+}
+
+void Stats_Add(StatsAcc *s, double y) {
+  double delta = y - s->mean;
+
+  s->n++;
+  s->sum += y;
+  s->mean += delta / s->n;
+  s->m2 += delta * (y - s->mean);
+
+  // N = n; the mean of the earlier sample numbers is n/2
+  s->cxy += (s->n / 2.0) * (y - s->mean);
+
+  if (s->n == 1 || y < s->min)
+    s->min = y;
+  if (s->n == 1 || y > s->max)
+    s->max = y;
+}
+
+void Stats_Rebuild(StatsAcc *s, const double *y, unsigned long n) {
+  unsigned long i;
+
+  Stats_Clear(s);
+  for (i = 0; i < n; i++)
+    Stats_Add(s, y[i]);
+}
+
+double Stats_Variance(const StatsAcc *s) {
+  return (s->n > 1) ? s->m2 / (s->n - 1) : 0.0;
+}
+
+int Stats_Trend(const StatsAcc *s, double *a, double *b, double *r) {
+  double n = (double)s->n;
+  double m2x = n * (n * n - 1.0) / 12.0; // Sum of (N - mean N)^2
+
+  if (s->n < 2)
+    return 1;
+  *b = s->cxy / m2x;
+  *a = s->mean - *b * (n + 1.0) / 2.0;
+  *r = (s->m2 > 0.0) ? s->cxy / sqrt(m2x * s->m2) : 0.0;
+  return 0;
+}
+
+// One "Label     value" row
+static void Stats_Row(unsigned char row, const char *label, double v) {
+  char line[32];
+  sprintf(line, "%-6s%14.7g", label, v);
+  lcdSetCursor(row, 0);
+  printDisplay(line);
+}
+
+static void Stats_Draw(int page) {
+  char line[32];
+  double a = 0.0, b = 0.0, r = 0.0;
+
+  lcdClearScreen();
+  sprintf(line, "Stats n=%-8lu %d/%d", g_acc.n, page + 1, STATS_PAGES);
+  printDisplay(line);
+
+  switch (page) {
+  case 0:
+    Stats_Row(1, "Mean", g_acc.mean);
+    Stats_Row(2, "SD", sqrt(Stats_Variance(&g_acc)));
+    break;
+  case 1:
+    Stats_Row(1, "Sum", g_acc.sum);
+    Stats_Row(2, "Var", Stats_Variance(&g_acc));
+    break;
+  case 2:
+    Stats_Row(1, "Min", g_acc.min);
+    Stats_Row(2, "Max", g_acc.max);
+    break;
+  case 3:
+    Stats_Trend(&g_acc, &a, &b, &r);
+    Stats_Row(1, "a", a); // y = a + b*N
+    Stats_Row(2, "b", b);
+    break;
+  default:
+    Stats_Trend(&g_acc, &a, &b, &r);
+    Stats_Row(1, "r", r);
+    lcdSetCursor(2, 0);
+    printDisplay("y = a + b*N");
+    break;
+  }
+
+  lcdSetCursor(3, 0); // Line 4: entry
+  printDisplay("> ");
+}
+
+#if STATS_LOG_SIZE > 0
+// Remove the newest sample by replaying the ones before it
+static int Stats_Undo(void) {
+  if (g_acc.n == 0 || g_acc.n > STATS_LOG_SIZE)
+    return 1; // Not in the log
+  Stats_Rebuild(&g_acc, g_log, g_acc.n - 1);
+  return 0;
+}
+#endif
+
+// Wait for the next key (released) and map it in 'layer', falling back
+// to the unshifted number layer
+static char Stats_GetKey(int layer) {
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(layer, k);
+      if (c == KEY_NONE)
+        c = Key_Map(KEY_LAYER_NUMBER, k);
+      while (readKeypad() != 0)
+        ; // Wait Release
+      return c;
+    }
+    SysTick_Wait10ms(5);
+  }
+}
+
+void Stats_Show(void) {
+  char numStr[16];
+  int idx = 0;
+  int shift = 0;
+  int page = 0;
+
+  Stats_Draw(page);
+  lcdCursorBlink();
+
+  while (1) {
+    char c = Stats_GetKey(KEY_LAYER_NUMBER + shift);
+    char ch = 0;
+
+    if ((c >= '0' && c <= '9') || c == '.') {
+      ch = c;
+    } else if (c == '-' && idx == 0) {
+      ch = c; // Sign only at start
+    } else if (c == KEY_ACT_SHIFT) {
+      shift = !shift;
+    } else if (c == KEY_ACT_BACK && idx > 0) {
+      idx--;
+      lcdBackspace();
+    } else if (c == KEY_ACT_BACK) {
+#if STATS_LOG_SIZE > 0
+      if (Stats_Undo() == 0)
+        Stats_Draw(page);
+#endif
+    } else if (c == KEY_ACT_EVAL && idx > 0) {
+      double y;
+
+      numStr[idx] = '\0';
+      idx = 0;
+      y = atof(numStr);
+#if STATS_LOG_SIZE > 0
+      if (g_acc.n < STATS_LOG_SIZE)
+        g_log[g_acc.n] = y;
+#endif
+      Stats_Add(&g_acc, y);
+      Stats_Draw(page);
+    } else if (c == KEY_ACT_NEXT) {
+      page = (page + 1) % STATS_PAGES;
+      Stats_Draw(page);
+      idx = 0; // Entry line was redrawn empty
+    } else if (c == KEY_ACT_MENU) {
+      lcdSetCursor(3, 0);
+      printDisplay("#:Clear 0:Exit     ");
+      c = Stats_GetKey(KEY_LAYER_PAGER);
+      if (c == KEY_ACT_EXIT)
+        return;
+      if (c == KEY_ACT_NEXT)
+        Stats_Clear(&g_acc);
+      Stats_Draw(page);
+      idx = 0;
+    }
+
+    if (ch && idx < (int)sizeof(numStr) - 1) {
+      numStr[idx++] = ch;
+      lcdWriteData(ch);
+      shift = 0;
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * File: stats.h
+ * Description: Public interface for Statistics mode.
+ *              Samples are folded into running totals (Welford's update),
+ *              so every statistic is available at once in constant RAM.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+// Samples kept for Undo; 0 disables the log
+#ifndef STATS_LOG_SIZE
+#define STATS_LOG_SIZE 128
+#endif
+
+typedef struct {
+  unsigned long n;
+  double sum;
+  double mean;
+  double m2;  // Sum of squared deviations from the mean
+  double cxy; // Co-moment with the sample number N (trend)
+  double min;
+  double max;
+} StatsAcc;
+
+// Reset to no samples
+void Stats_Clear(StatsAcc *s);
+
+// Fold in one sample
+void Stats_Add(StatsAcc *s, double y);
+
+// Reset and fold in y[0..n-1] again. Gives bit for bit the totals the
+// same Stats_Add calls gave, which subtracting a sample back out cannot
+void Stats_Rebuild(StatsAcc *s, const double *y, unsigned long n);
+
+// Sample variance (n - 1), 0 below two samples
+double Stats_Variance(const StatsAcc *s);
+
+// Least squares line y = a + b*N over sample numbers N = 1..n, and the
+// correlation r. Returns 0 on success, 1 below two samples
+int Stats_Trend(const StatsAcc *s, double *a, double *b, double *r);
+
+// Statistics screen
+// Keys: digits, Sh+0:., B:-, #:Add, *:Backspace/Undo, A:Next page,
+//       C:Menu (then #:Clear 0:Exit)
+void Stats_Show(void);
+
+#endif
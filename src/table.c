@@ -0,0 +1,87 @@
+/*
+ * File: table.c
+ * Description: Table mode. Evaluates a compiled f(X) for
+ *              X = start, start+step, ... and shows it 3 rows at a time.
+ */
+
+#include "table.h"
+
+#include "SysTick.h"
+#include "keymap.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "menu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TABLE_ROWS 3 // Line 1 is the header
+
+// Format a value into at most 'width' chars
+static void Table_FormatCell(double v, char *out, int width) {
+  if (v == (long)v)
+    sprintf(out, "%ld", (long)v);
+  else
+    sprintf(out, "%.3f", v);
+
+  if ((int)strlen(out) > width)
+    sprintf(out, "%.*e", (width > 8) ? width - 7 : 1, v);
+}
+
+// Draw rows for X = start + (first .. first+TABLE_ROWS-1) * step
+static void Table_Draw(const ExprProgram *prog, const double *vars,
+                       double start, double step, int first) {
+  double xs[TABLE_ROWS];
+  double ys[TABLE_ROWS];
+  char xStr[24];
+  char yStr[24];
+  char line[24];
+  int r;
+
+  for (r = 0; r < TABLE_ROWS; r++)
+    xs[r] = start + (first + r) * step;
+
+  Expr_RunBatch(prog, vars, xs, ys, TABLE_ROWS);
+
+  // Full-width rows overwrite the old ones, so no clear is needed
+  lcdWriteRow(0, "X        f(X)");
+
+  for (r = 0; r < TABLE_ROWS; r++) {
+    Table_FormatCell(xs[r], xStr, 8);
+    Table_FormatCell(ys[r], yStr, 11);
+    sprintf(line, "%-8s %11s", xStr, yStr);
+    lcdWriteRow(r + 1, line);
+  }
+}
+
+void Table_Show(const ExprProgram *prog, const double *vars) {
+  double start = Menu_ReadNumber("Start X:", 0.0);
+  double step = Menu_ReadNumber("Step:", 1.0);
+  int first = 0;
+
+  lcdCursorOff();
+  Table_Draw(prog, vars, start, step, first);
+
+  while (1) {
+    unsigned char k = readKeypad();
+    if (k != 0) {
+      char c = Key_Map(KEY_LAYER_PAGER, k);
+
+      // Wait for release
+      while (readKeypad() != 0)
+        ;
+
+      if (c == KEY_ACT_EXIT)
+        return;
+      if (c == KEY_ACT_NEXT) {
+        first++; // Scroll down
+        Table_Draw(prog, vars, start, step, first);
+      }
+      if (c == KEY_ACT_PREV) {
+        first--; // Scroll up (X below start is fine)
+        Table_Draw(prog, vars, start, step, first);
+      }
+    }
+    SysTick_Wait10ms(5);
+  }
+}
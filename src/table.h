@@ -0,0 +1,16 @@
+/*
+ * File: table.h
+ * Description: Public interface for Table mode (f(X) over a range of X).
+ */
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "expr.h"
+
+// Prompts for start and step, then shows a scrollable table of f(X)
+// vars[] supplies every variable except X
+// Keys: #:Down *:Up 0:Exit
+void Table_Show(const ExprProgram *prog, const double *vars);
+
+#endif
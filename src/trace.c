@@ -0,0 +1,481 @@
+/*
+ * File: trace.c
+ * Description: Key trace recorder and replayer.
+ *              A trace is a list of keypad edges, each packed in one word:
+ *              the raw code (0 = release) in the top byte and the
+ *              milliseconds since the previous edge below it. Replay hands
+ *              each edge to readKeypad at the time it was recorded, so the
+ *              firmware runs exactly as it did for the user, waits and all.
+ *
+ *              Latency is measured from the press to the last LCD byte
+ *              sent before the next press. On replay the press time is when
+ *              the edge was due, so time the firmware spent not polling the
+ *              keypad counts too. A replayed press that is released before
+ *              the firmware reads the keypad is a dropped key.
+ *
+ *              The energy model is read at the same points: charge from
+ *              reading a press to its last LCD write is the cost of the
+ *              key, and from there to the next press is idle.
+ */
+
+#include "trace.h"
+
+#include "Flash.h"
+#include "password.h"
+#include "perf.h"
+#include "power.h"
+
+#include <stdint.h>
+
+// Flash page layout (words)
+#define TRACE_MAGIC 0x54524345 // "TRCE"
+#define TRACE_W_MAGIC 0
+#define TRACE_W_LAYOUT 1 // TRACE_LAYOUT; pages with another one are dropped
+#define TRACE_W_EDGES 2
+#define TRACE_W_PIN 3 // PIN record the trace was made with
+#define TRACE_W_BASE (TRACE_W_PIN + PASSWORD_RECORD_WORDS) // Erased = none
+#define TRACE_BASE_WORDS 7
+#define TRACE_HEADER_WORDS (TRACE_W_BASE + TRACE_BASE_WORDS)
+
+// Revision in the top bits, header size below. Bump the revision when
+// words move without the size changing.
+#define TRACE_LAYOUT ((3UL << 16) | TRACE_HEADER_WORDS)
+
+#define TRACE_CYCLES_PER_MS (PERF_CYCLES_PER_US * 1000UL)
+#define TRACE_MAX_DELTA 0x00FFFFFF // ms, ~4.6 hours between edges
+
+static int g_state = TRACE_IDLE;
+
+static uint32_t g_edges[TRACE_MAX_EDGES];
+static int g_numEdges = 0;
+static uint32_t g_pin[PASSWORD_RECORD_WORDS];
+
+static unsigned long long g_start; // Start of the run
+static unsigned long long g_edge;  // Last recorded edge
+static unsigned char g_last;       // Last recorded code
+
+// Replay position
+static int g_next;                // Next edge to hand out
+static unsigned long long g_due;  // When g_edges[g_next] is due
+static unsigned long long g_down; // When the current key went down
+static unsigned char g_cur;       // Code readKeypad returns
+static int g_unseen;              // g_cur is a press not read yet
+
+// Open latency window
+static int g_pressKey = -1;
+static unsigned long long g_pressTime;
+static unsigned long long g_lcdTime;
+static unsigned long long g_pressCharge; // pC, from Power_Charge
+static unsigned long long g_lcdCharge;
+
+// Charge totals over the run
+static int g_idleOpen = 0; // An update ended; idle until the next press
+static unsigned long long g_idleTime;
+static unsigned long long g_idleCharge;
+static unsigned long long g_keyCharge; // Summed over g_numLat presses
+static unsigned long long g_idleCycles;
+static unsigned long long g_idleSum;
+
+static unsigned short g_lat[TRACE_MAX_EDGES / 2]; // ms, one per press
+static int g_numLat;
+static TraceKey g_keys[TRACE_NUM_KEYS];
+static unsigned long g_dropped;
+
+static TraceResult g_result;
+static int g_haveResult = 0;
+static TraceResult g_base;
+static int g_haveBase = 0;
+
+// Soak test
+static int g_soakLeft = 0; // Replays still to run
+static int g_jitter = 0;   // Scale replayed gaps at random
+static unsigned long g_seed;
+static TraceSoak g_soak;
+
+// Cycle clock widened to 64 bits. The DWT counter wraps every ~53 s, and
+// every keypad wait loop polls far more often than that.
+static unsigned long long Trace_Clock(void) { return Perf_Cycles64(); }
+
+static unsigned long Trace_Ms(unsigned long long cycles) {
+  return (unsigned long)(cycles / TRACE_CYCLES_PER_MS);
+}
+
+// Replay time of an edge in cycles. Soak runs stretch or squeeze each
+// gap by up to TRACE_JITTER_PCT percent (xorshift, fixed seed, so a soak
+// is the same every time).
+static unsigned long long Trace_Gap(uint32_t edge) {
+  unsigned long long ms = edge & TRACE_MAX_DELTA;
+  unsigned long pct;
+
+  if (g_jitter) {
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 17;
+    g_seed ^= g_seed << 5;
+    pct = 100 - TRACE_JITTER_PCT + (g_seed >> 8) % (2 * TRACE_JITTER_PCT + 1);
+    ms = ms * pct / 100;
+  }
+  return ms * TRACE_CYCLES_PER_MS;
+}
+
+// Key number row * 4 + column from a raw code (lowest column if several)
+static int Trace_Index(unsigned char code) {
+  int col = 0;
+  while (col < 3 && !(code & (1 << col)))
+    col++;
+  return ((code >> 4) & 3) * 4 + col;
+}
+
+// Close the latency window of the last press, if it reached the LCD
+static void Trace_Close(void) {
+  unsigned long ms;
+  TraceKey *k;
+
+  if (g_pressKey < 0)
+    return;
+
+  if (g_lcdTime > g_pressTime) {
+    ms = Trace_Ms(g_lcdTime - g_pressTime);
+    if (ms > 0xFFFF)
+      ms = 0xFFFF;
+
+    k = &g_keys[g_pressKey];
+    k->count++;
+    k->sumMs += ms;
+    if (ms > k->maxMs)
+      k->maxMs = (unsigned short)ms;
+    if (g_numLat < TRACE_MAX_EDGES / 2) {
+      g_lat[g_numLat++] = (unsigned short)ms;
+      g_keyCharge += g_lcdCharge - g_pressCharge;
+    }
+
+    g_idleOpen = 1;
+    g_idleTime = g_lcdTime;
+    g_idleCharge = g_lcdCharge;
+  }
+  g_pressKey = -1;
+}
+
+static void Trace_Press(unsigned char code, unsigned long long t) {
+  unsigned long long charge;
+
+  Trace_Close();
+  charge = Power_Charge();
+  if (g_idleOpen) {
+    g_idleCycles += Trace_Clock() - g_idleTime;
+    g_idleSum += charge - g_idleCharge;
+    g_idleOpen = 0;
+  }
+
+  g_pressKey = Trace_Index(code);
+  g_pressTime = t;
+  g_pressCharge = charge;
+  g_lcdTime = 0;
+}
+
+static void Trace_Clear(void) {
+  int i;
+
+  for (i = 0; i < TRACE_NUM_KEYS; i++) {
+    g_keys[i].count = 0;
+    g_keys[i].maxMs = 0;
+    g_keys[i].sumMs = 0;
+  }
+  g_numLat = 0;
+  g_dropped = 0;
+  g_pressKey = -1;
+  g_idleOpen = 0;
+  g_keyCharge = 0;
+  g_idleCycles = 0;
+  g_idleSum = 0;
+  g_haveResult = 0;
+  g_start = g_edge = Trace_Clock();
+}
+
+// Write the trace and baseline over the flash page
+static void Trace_Save(void) {
+  uint32_t base[TRACE_BASE_WORDS];
+  int i;
+
+  for (i = 0; i < TRACE_BASE_WORDS; i++)
+    base[i] = 0xFFFFFFFF;
+  if (g_haveBase) {
+    base[0] = g_base.p50Ms;
+    base[1] = g_base.p95Ms;
+    base[2] = g_base.maxMs;
+    base[3] = g_base.dropped;
+    base[4] = g_base.sessionMs;
+    base[5] = g_base.keyUc;
+    base[6] = g_base.idleUa;
+  }
+
+  Flash_Erase(FLASH_TRACE_ADDR);
+  Flash_Write(FLASH_TRACE_ADDR + 4 * TRACE_W_MAGIC, TRACE_MAGIC);
+  Flash_Write(FLASH_TRACE_ADDR + 4 * TRACE_W_LAYOUT, TRACE_LAYOUT);
+  Flash_Write(FLASH_TRACE_ADDR + 4 * TRACE_W_EDGES, g_numEdges);
+  for (i = 0; i < PASSWORD_RECORD_WORDS; i++)
+    Flash_Write(FLASH_TRACE_ADDR + 4 * (TRACE_W_PIN + i), g_pin[i]);
+  for (i = 0; i < TRACE_BASE_WORDS; i++)
+    Flash_Write(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + i), base[i]);
+  for (i = 0; i < g_numEdges; i++)
+    Flash_Write(FLASH_TRACE_ADDR + 4 * (TRACE_HEADER_WORDS + i), g_edges[i]);
+}
+
+void Trace_Init(void) {
+  uint32_t n;
+  int i;
+
+  g_numEdges = 0;
+  g_haveBase = 0;
+
+  if (Flash_Read(FLASH_TRACE_ADDR + 4 * TRACE_W_MAGIC) != TRACE_MAGIC ||
+      Flash_Read(FLASH_TRACE_ADDR + 4 * TRACE_W_LAYOUT) != TRACE_LAYOUT)
+    return; // None, or written by a build with another layout
+
+  n = Flash_Read(FLASH_TRACE_ADDR + 4 * TRACE_W_EDGES);
+  if (n > TRACE_MAX_EDGES)
+    return;
+
+  for (i = 0; i < PASSWORD_RECORD_WORDS; i++)
+    g_pin[i] = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_PIN + i));
+  for (i = 0; i < (int)n; i++)
+    g_edges[i] = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_HEADER_WORDS + i));
+  g_numEdges = (int)n;
+
+  if (Flash_Read(FLASH_TRACE_ADDR + 4 * TRACE_W_BASE) != 0xFFFFFFFF) {
+    g_base.p50Ms = Flash_Read(FLASH_TRACE_ADDR + 4 * TRACE_W_BASE);
+    g_base.p95Ms = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 1));
+    g_base.maxMs = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 2));
+    g_base.dropped = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 3));
+    g_base.sessionMs = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 4));
+    g_base.keyUc = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 5));
+    g_base.idleUa = Flash_Read(FLASH_TRACE_ADDR + 4 * (TRACE_W_BASE + 6));
+    g_haveBase = 1;
+  }
+}
+
+static unsigned char Trace_RecordKey(unsigned char code) {
+  unsigned long long now = Trace_Clock();
+  unsigned long ms;
+
+  if (code == g_last)
+    return code;
+
+  if (g_numEdges == TRACE_MAX_EDGES) {
+    Trace_Stop(); // Full: keep what we have
+    return code;
+  }
+
+  ms = Trace_Ms(now - g_edge);
+  if (ms > TRACE_MAX_DELTA)
+    ms = TRACE_MAX_DELTA;
+  g_edges[g_numEdges++] = ((uint32_t)code << 24) | ms;
+  g_edge = now;
+  g_last = code;
+
+  if (code != 0)
+    Trace_Press(code, now);
+  return code;
+}
+
+static unsigned char Trace_ReplayKey(void) {
+  unsigned long long now = Trace_Clock();
+
+  // Hand out every edge that is due. A press replaced before anyone
+  // read it was dropped.
+  while (g_next < g_numEdges && now >= g_due) {
+    if (g_cur != 0 && g_unseen)
+      g_dropped++;
+    g_cur = (unsigned char)(g_edges[g_next] >> 24);
+    g_unseen = (g_cur != 0);
+    g_down = g_due;
+    if (++g_next < g_numEdges)
+      g_due += Trace_Gap(g_edges[g_next]);
+  }
+
+  if (g_unseen) {
+    g_unseen = 0;
+    Trace_Press(g_cur, g_down);
+  }
+
+  if (g_next == g_numEdges && g_cur == 0)
+    Trace_Stop(); // Ran out: the keypad is live again
+  return g_cur;
+}
+
+unsigned char Trace_Key(unsigned char code) {
+  if (g_state == TRACE_RECORD)
+    return Trace_RecordKey(code);
+  if (g_state == TRACE_REPLAY) {
+    if (code == 0)
+      return Trace_ReplayKey();
+    g_soakLeft = 0; // A real key takes over
+    Trace_Stop();
+  }
+  return code;
+}
+
+void Trace_Lcd(void) {
+  if (g_pressKey >= 0) {
+    g_lcdTime = Trace_Clock();
+    g_lcdCharge = Power_Charge();
+  }
+}
+
+void Trace_Record(void) {
+  int i;
+
+  g_numEdges = 0;
+  g_haveBase = 0; // A new trace needs a new baseline
+  for (i = 0; i < PASSWORD_RECORD_WORDS; i++)
+    g_pin[i] = Flash_Read(FLASH_PASSWORD_ADDR + 4 * i);
+  Trace_Clear();
+  g_last = 0;
+  g_state = TRACE_RECORD;
+}
+
+// Begin a replay; soak runs vary the gaps
+static int Trace_Start(int jitter) {
+  if (g_numEdges == 0)
+    return 1;
+
+  Trace_Clear();
+  g_jitter = jitter;
+  g_next = 0;
+  g_cur = 0;
+  g_unseen = 0;
+  g_due = g_start + Trace_Gap(g_edges[0]);
+  g_state = TRACE_REPLAY;
+  return 0;
+}
+
+void Trace_Stop(void) {
+  int state = g_state;
+  int i, j;
+
+  if (state == TRACE_IDLE)
+    return;
+  g_state = TRACE_IDLE;
+
+  Trace_Close();
+
+  // Sort the latencies for the percentiles (at most a hundred or so)
+  for (i = 1; i < g_numLat; i++) {
+    unsigned short v = g_lat[i];
+    for (j = i; j > 0 && g_lat[j - 1] > v; j--)
+      g_lat[j] = g_lat[j - 1];
+    g_lat[j] = v;
+  }
+
+  g_result.p50Ms = 0;
+  g_result.p95Ms = 0;
+  g_result.maxMs = 0;
+  if (g_numLat > 0) {
+    g_result.p50Ms = g_lat[(g_numLat - 1) / 2];
+    g_result.p95Ms = g_lat[(g_numLat * 95 + 99) / 100 - 1]; // Nearest rank
+    g_result.maxMs = g_lat[g_numLat - 1];
+  }
+  g_result.dropped = g_dropped;
+  g_result.sessionMs = Trace_Ms(Trace_Clock() - g_start);
+  g_result.keyUc = 0;
+  if (g_numLat > 0)
+    g_result.keyUc = (unsigned long)(g_keyCharge / g_numLat / 1000000);
+  g_result.idleUa = 0;
+  if (g_idleCycles > 0) // pC / us = uA
+    g_result.idleUa =
+        (unsigned long)(g_idleSum / (g_idleCycles / PERF_CYCLES_PER_US + 1));
+  g_haveResult = 1;
+
+  if (state == TRACE_REPLAY && g_jitter) {
+    g_soak.runs++;
+    g_soak.edges += g_next;
+    g_soak.ms += g_result.sessionMs;
+    g_soak.dropped += g_dropped;
+    if (g_dropped > 0 || (Trace_Regressions() & 1))
+      g_soak.bad++;
+  }
+
+  if (state == TRACE_RECORD)
+    Trace_Save();
+}
+
+int Trace_Replay(void) {
+  g_soakLeft = 0;
+  return Trace_Start(0);
+}
+
+int Trace_Soak(void) {
+  if (g_numEdges == 0)
+    return 1;
+
+  g_soak.runs = 0;
+  g_soak.bad = 0;
+  g_soak.edges = 0;
+  g_soak.ms = 0;
+  g_soak.dropped = 0;
+  g_seed = 0x2545F491;
+  g_soakLeft = TRACE_SOAK_RUNS;
+  return Trace_SoakNext();
+}
+
+int Trace_SoakNext(void) {
+  if (g_soakLeft == 0)
+    return 1;
+  g_soakLeft--;
+  return Trace_Start(1);
+}
+
+const TraceSoak *Trace_SoakResult(void) {
+  return g_soak.runs > 0 ? &g_soak : 0;
+}
+
+const uint32_t *Trace_PinRecord(void) {
+  return (g_state == TRACE_REPLAY) ? g_pin : 0;
+}
+
+int Trace_State(void) { return g_state; }
+
+int Trace_Edges(void) { return g_numEdges; }
+
+const TraceResult *Trace_Result(void) {
+  return g_haveResult ? &g_result : 0;
+}
+
+const TraceKey *Trace_KeyStats(int key) {
+  if (!g_haveResult || key < 0 || key >= TRACE_NUM_KEYS)
+    return 0;
+  return &g_keys[key];
+}
+
+const TraceResult *Trace_Baseline(void) { return g_haveBase ? &g_base : 0; }
+
+int Trace_SaveBaseline(void) {
+  if (!g_haveResult || g_numEdges == 0)
+    return 1;
+
+  g_base = g_result;
+  g_haveBase = 1;
+  Trace_Save();
+  return 0;
+}
+
+// Over the baseline by more than TRACE_SLACK_PCT percent plus the slack
+static int Trace_Over(unsigned long now, unsigned long base) {
+  return now > base + base * TRACE_SLACK_PCT / 100 + TRACE_SLACK_MS;
+}
+
+int Trace_Regressions(void) {
+  int flags = 0;
+
+  if (!g_haveResult || !g_haveBase)
+    return 0;
+
+  if (Trace_Over(g_result.p95Ms, g_base.p95Ms))
+    flags |= 1;
+  if (g_result.dropped > g_base.dropped)
+    flags |= 2;
+  if (Trace_Over(g_result.sessionMs, g_base.sessionMs))
+    flags |= 4;
+  if (g_result.keyUc > g_base.keyUc + g_base.keyUc * TRACE_SLACK_PCT / 100)
+    flags |= 8;
+  return flags;
+}
@@ -0,0 +1,113 @@
+/*
+ * File: trace.h
+ * Description: Public interface for the key trace recorder.
+ *              Every press and release seen by readKeypad is logged with
+ *              its time, so a session can be kept in flash and replayed
+ *              through the whole firmware later, in real time, with the
+ *              keypad switched off. Both runs measure how long each key
+ *              takes to finish updating the LCD, and the charge it costs
+ *              (power.h).
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Edges (press or release) kept; the flash page holds a header and these
+#define TRACE_MAX_EDGES 232
+
+// Keys on the pad, for per-key results
+#define TRACE_NUM_KEYS 16
+
+// Regression limits against the baseline
+#define TRACE_SLACK_MS 20 // Latency below this much over baseline is noise
+#define TRACE_SLACK_PCT 10
+
+// Soak test: replays in a row, each gap varied by up to this much
+#define TRACE_SOAK_RUNS 20
+#define TRACE_JITTER_PCT 50
+
+#define TRACE_IDLE 0
+#define TRACE_RECORD 1
+#define TRACE_REPLAY 2
+
+typedef struct {
+  unsigned short count; // Presses the firmware saw
+  unsigned short maxMs; // Slowest press to last LCD write
+  unsigned long sumMs;
+} TraceKey;
+
+typedef struct {
+  unsigned long p50Ms; // Latency percentiles over all presses
+  unsigned long p95Ms;
+  unsigned long maxMs;
+  unsigned long dropped;   // Replayed presses the firmware never read
+  unsigned long sessionMs; // Start to stop
+  unsigned long keyUc;     // Charge from reading a press to its last update
+  unsigned long idleUa;    // Mean current between updates and presses
+} TraceResult;
+
+typedef struct {
+  int runs;
+  int bad;               // Runs with drops or a latency regression
+  unsigned long edges;   // Key edges replayed
+  unsigned long ms;      // Time spent replaying
+  unsigned long dropped; // Over all runs
+} TraceSoak;
+
+// Load the last saved trace and baseline from flash
+void Trace_Init(void);
+
+// Pass one keypad scan through the recorder. Records it, or replaces it
+// with the replayed key while a replay is running.
+unsigned char Trace_Key(unsigned char code);
+
+// Called by the LCD driver for every byte it sends
+void Trace_Lcd(void);
+
+// Start recording, dropping the trace in RAM
+void Trace_Record(void);
+
+// Start replaying the trace. A real key press stops it.
+// Returns 0 = OK, 1 = Error (no trace)
+int Trace_Replay(void);
+
+// Start TRACE_SOAK_RUNS replays with randomly varied timing, to shake out
+// drops that only show up when keys come faster. Returns 0 = OK, 1 = Error
+int Trace_Soak(void);
+
+// Start the next soak run after one ends. Returns 0 = started, 1 = soak
+// done (or stopped by a real key)
+int Trace_SoakNext(void);
+
+// Totals of the last soak; NULL if none ran
+const TraceSoak *Trace_SoakResult(void);
+
+// End a recording (saved to flash) or replay and work out the results.
+// Does nothing when idle.
+void Trace_Stop(void);
+
+int Trace_State(void);
+
+// The PIN record saved with the trace while it replays, NULL otherwise.
+// The PIN module checks against it and writes nothing, so the typed PIN
+// unlocks and the live record is never touched.
+const uint32_t *Trace_PinRecord(void);
+int Trace_Edges(void);
+
+// Results of the last run; NULL if there is none yet
+const TraceResult *Trace_Result(void);
+const TraceKey *Trace_KeyStats(int key); // key = row * 4 + column
+
+// The stored baseline; NULL if none was saved
+const TraceResult *Trace_Baseline(void);
+
+// Make the last results the baseline. Returns 0 = OK, 1 = Error
+int Trace_SaveBaseline(void);
+
+// Bit 0: latency regressed, bit 1: more drops, bit 2: slower session,
+// bit 3: more charge per key
+int Trace_Regressions(void);
+
+#endif